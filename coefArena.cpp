@@ -0,0 +1,76 @@
+#include <stdint.h> // SIZE_MAX
+#include <stdlib.h>
+
+#include "coefArena.h"
+
+CoefArena::CoefArena()
+    : m_front(NULL), m_back(NULL), m_front_capacity(0), m_back_capacity(0), m_block_sum(0)
+{
+}
+
+// 接管另一个缓冲区的内存 (用于存放在 std::vector 中)
+CoefArena::CoefArena(CoefArena &&other)
+    : m_front(other.m_front), m_back(other.m_back), m_front_capacity(other.m_front_capacity),
+      m_back_capacity(other.m_back_capacity), m_block_sum(other.m_block_sum)
+{
+    other.m_front = NULL;
+    other.m_back = NULL;
+    other.m_front_capacity = 0;
+    other.m_back_capacity = 0;
+    other.m_block_sum = 0;
+}
+
+CoefArena::~CoefArena()
+{
+    free(m_front);
+    free(m_back);
+}
+
+/**
+ * @brief 将缓冲区扩大到至少 block_sum 个块 (原有内容不保留)
+ * @param buffer 缓冲区指针
+ * @param capacity 缓冲区已分配的块数
+ * @param block_sum 需要的块数
+ * @return 无法分配 (或字节数溢出) 时返回 false，此时缓冲区为空
+ */
+bool CoefArena::grow(JCOEF *&buffer, size_t &capacity, size_t block_sum)
+{
+    free(buffer);
+    buffer = NULL;
+    capacity = 0;
+
+    if (block_sum > SIZE_MAX / (sizeof(JCOEF) * AC_STRIDE))
+        return false;
+
+    // AC_STRIDE 个 JCOEF 恰为 ARENA_ALIGNMENT 的整数倍，满足 aligned_alloc 对大小的要求
+    buffer = (JCOEF *)aligned_alloc(ARENA_ALIGNMENT, sizeof(JCOEF) * AC_STRIDE * block_sum);
+    if (!buffer)
+        return false;
+    capacity = block_sum;
+    return true;
+}
+
+/**
+ * @brief 准备容纳 block_sum 个块，容量不足时重新分配 (原有内容不保留)
+ * @param block_sum 块的数量
+ * @return 无法分配时返回 false (此时块数为 0)
+ */
+bool CoefArena::reset(size_t block_sum)
+{
+    m_block_sum = 0;
+    if (m_front_capacity < block_sum && !grow(m_front, m_front_capacity, block_sum))
+        return false;
+    m_block_sum = block_sum;
+    return true;
+}
+
+/**
+ * @brief 使后台缓冲区能够容纳当前的块数，容量不足时重新分配
+ * @return 无法分配时返回 false
+ */
+bool CoefArena::reserveBack()
+{
+    if (m_back_capacity < m_block_sum)
+        return grow(m_back, m_back_capacity, m_block_sum);
+    return true;
+}
@@ -0,0 +1,108 @@
+#ifndef COEFARENA_H
+#define COEFARENA_H
+
+#include <stddef.h>
+#include <stdio.h> // jpeglib.h 需要 FILE
+
+#include "jpeglib.h" // JCOEF, DCTSIZE2
+
+// 系数缓冲区中相邻两个块的间隔 (JCOEF 个数)：前 63 个为 zigzag 顺序的AC系数，通道 63 为原DC (不参与置乱)
+#define AC_STRIDE DCTSIZE2
+
+// 系数缓冲区的对齐字节数 (缓存行大小，同时满足 AVX2 对齐要求)
+#define ARENA_ALIGNMENT 64
+
+// 缓冲区中的一个块，整块搬移时使用
+typedef struct
+{
+    JCOEF coef[AC_STRIDE];
+} acBlock;
+
+/**
+ * @brief 连续存储一个分量所有AC系数块的双缓冲区
+ * 第 i 个块位于 data() + i * AC_STRIDE：缓冲区起始地址按 ARENA_ALIGNMENT (64 字节) 对齐，
+ * 块与块之间间隔 128 字节，因此每个块都从缓存行边界开始，避免逐块 malloc 与指针跳转。
+ * 置乱时从前台缓冲区收集 (gather) 到后台缓冲区，再交换前后台；
+ * 后台缓冲区由 reserveBack() 分配，原地置乱模式下不调用，不占用内存。
+ * 分配失败时返回 false，由调用者报告错误 (不终止进程)。
+ * 容量只增不减，可以在多个分量、多张图像之间复用。
+ */
+class CoefArena
+{
+private:
+    JCOEF *m_front;          // 当前有效数据
+    JCOEF *m_back;           // 置乱时的目标缓冲区
+    size_t m_front_capacity; // 前台缓冲区已分配的块数
+    size_t m_back_capacity;  // 后台缓冲区已分配的块数
+    size_t m_block_sum;      // 当前使用的块数
+
+    static bool grow(JCOEF *&buffer, size_t &capacity, size_t block_sum);
+
+    CoefArena(const CoefArena &);
+    CoefArena &operator=(const CoefArena &);
+
+public:
+    CoefArena();
+    CoefArena(CoefArena &&other);
+    ~CoefArena();
+
+    /**
+     * @brief 准备容纳 block_sum 个块，容量不足时重新分配 (原有内容不保留)
+     * @param block_sum 块的数量
+     * @return 无法分配时返回 false (此时块数为 0)
+     */
+    bool reset(size_t block_sum);
+
+    /**
+     * @brief 使后台缓冲区能够容纳当前的块数，容量不足时重新分配
+     * @return 无法分配时返回 false
+     */
+    bool reserveBack();
+
+    // 第 block_index 个块的AC系数 (zigzag 顺序)
+    JCOEF *block(size_t block_index)
+    {
+        return m_front + block_index * AC_STRIDE;
+    }
+
+    const JCOEF *block(size_t block_index) const
+    {
+        return m_front + block_index * AC_STRIDE;
+    }
+
+    // 前台缓冲区的起始地址
+    JCOEF *data()
+    {
+        return m_front;
+    }
+
+    // 前台缓冲区按块访问
+    acBlock *blocks()
+    {
+        return (acBlock *)m_front;
+    }
+
+    // 后台缓冲区的起始地址 (须先调用 reserveBack())，写满后调用 swap() 使其成为前台
+    JCOEF *backData()
+    {
+        return m_back;
+    }
+
+    void swap()
+    {
+        JCOEF *temp = m_front;
+        m_front = m_back;
+        m_back = temp;
+
+        size_t temp_capacity = m_front_capacity;
+        m_front_capacity = m_back_capacity;
+        m_back_capacity = temp_capacity;
+    }
+
+    size_t blockSum() const
+    {
+        return m_block_sum;
+    }
+};
+
+#endif // COEFARENA_H
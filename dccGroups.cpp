@@ -0,0 +1,51 @@
+#include "dccGroups.h"
+
+/**
+ * @brief 把DCC序列分割为符号相同 (非负或负) 的连续分组，记录各分组的起始位置
+ * @param diff_ptr DCC序列
+ * @param n DCC的数量
+ * @param group_offset 输出：各分组的起始位置，共 返回值 + 1 项，最后一项为 n (至少 n + 2 项的空间)
+ * @return 分组数量 (n 为 0 时为 1 个空分组)
+ */
+size_t splitSameSignGroups(const JCOEF *diff_ptr, size_t n, uint32_t *group_offset)
+{
+    size_t group_num = 1;
+    group_offset[0] = 0;
+    for (size_t index = 1; index < n; ++index)
+    {
+        // 符号与前一个DCC不同时开始新的分组
+        if ((diff_ptr[index] < 0) != (diff_ptr[index - 1] < 0))
+            group_offset[group_num++] = (uint32_t)index;
+    }
+    group_offset[group_num] = (uint32_t)n;
+    return group_num;
+}
+
+/**
+ * @brief 由全局置乱表导出每个相同符号分组内部的置乱顺序 (线性时间)
+ * @param inverse 全局置乱表的逆映射，inverse[v] 为值 v 所在的位置 (长度 n)
+ * @param n DCC的数量
+ * @param group_offset 各分组的起始位置 (group_num + 1 项，最后一项为 n)
+ * @param group_num 分组数量
+ * @param group_of 临时数组 (n 项)，填写每个位置所属的分组
+ * @param cursor 临时数组 (group_num 项)
+ * @param group_order 输出：group_order[group_offset[g] + i] 为分组 g 内置乱后位置 i 的DCC在该组中的原始索引
+ */
+void deriveGroupOrder(const uint32_t *inverse, size_t n, const uint32_t *group_offset, size_t group_num,
+                      uint32_t *group_of, uint32_t *cursor, uint32_t *group_order)
+{
+    for (size_t group_index = 0; group_index < group_num; ++group_index)
+    {
+        cursor[group_index] = group_offset[group_index];
+        for (uint32_t position = group_offset[group_index]; position < group_offset[group_index + 1]; ++position)
+            group_of[position] = (uint32_t)group_index;
+    }
+
+    // 值从小到大遍历，每个分组内的位置按值的顺序依次写入
+    for (size_t value = 0; value < n; ++value)
+    {
+        uint32_t position = inverse[value];
+        uint32_t group_index = group_of[position];
+        group_order[cursor[group_index]++] = position - group_offset[group_index];
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef DCCGROUPS_H
+#define DCCGROUPS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h> // jpeglib.h 需要 FILE
+
+#include "jpeglib.h" // JCOEF
+
+// DCC相同符号分组置乱时每个并行任务处理的分组数
+#define DCC_GROUP_GRAIN 4096
+
+/**
+ * @brief 把DCC序列分割为符号相同 (非负或负) 的连续分组，记录各分组的起始位置
+ * @param diff_ptr DCC序列
+ * @param n DCC的数量
+ * @param group_offset 输出：各分组的起始位置，共 返回值 + 1 项，最后一项为 n (至少 n + 2 项的空间)
+ * @return 分组数量 (n 为 0 时为 1 个空分组)
+ */
+size_t splitSameSignGroups(const JCOEF *diff_ptr, size_t n, uint32_t *group_offset);
+
+/**
+ * @brief 由全局置乱表导出每个相同符号分组内部的置乱顺序 (线性时间)
+ * 分组内的DCC按全局置乱表中对应的值从小到大排列，这正是全局顺序限制在该分组上的结果，
+ * 因此按值从小到大遍历一次逆映射，把每个位置依次追加到所属分组的末尾即可，不需要对每个分组排序。
+ * 结果与原实现中对每个分组的 intPair 序列按值排序后的 number 逐项相同 (置乱表的值互不相同)。
+ * @param inverse 全局置乱表的逆映射，inverse[v] 为值 v 所在的位置 (长度 n)
+ * @param n DCC的数量
+ * @param group_offset 各分组的起始位置 (group_num + 1 项，最后一项为 n)
+ * @param group_num 分组数量
+ * @param group_of 临时数组 (n 项)，填写每个位置所属的分组
+ * @param cursor 临时数组 (group_num 项)
+ * @param group_order 输出：group_order[group_offset[g] + i] 为分组 g 内置乱后位置 i 的DCC在该组中的原始索引
+ */
+void deriveGroupOrder(const uint32_t *inverse, size_t n, const uint32_t *group_offset, size_t group_num,
+                      uint32_t *group_of, uint32_t *cursor, uint32_t *group_order);
+
+#endif // DCCGROUPS_H
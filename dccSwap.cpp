@@ -0,0 +1,193 @@
+#include "dccSwap.h"
+
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DCCSWAP_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief 标量实现：与原 dccIterSwap 中的判断逐步对应
+ */
+static int canSwapScalar(const JCOEF *group_ptr, int half_size, int floor_dc, int ceiling_dc)
+{
+    int prev_dc = 0;
+
+    // 先检查右半部分，再接着检查左半部分
+    for (int i = half_size; i < 2 * half_size; ++i)
+    {
+        prev_dc += group_ptr[i];
+        if (!(prev_dc <= ceiling_dc && prev_dc >= floor_dc))
+            return 0;
+    }
+    for (int i = 0; i < half_size; ++i)
+    {
+        prev_dc += group_ptr[i];
+        if (!(prev_dc <= ceiling_dc && prev_dc >= floor_dc))
+            return 0;
+    }
+    return 1;
+}
+
+/* 向量实现的思路：
+ * 右半部分的部分和就是它自身的前缀和 P_R(k)；左半部分的部分和为 S_R + P_L(k)，S_R 为右半部分总和。
+ * 两半各自求一次 int32 前缀和，再比较最小值、最大值即可，与逐个累加的判断等价。
+ * 每半部分按 16 个通道处理 (8 <= t <= 16 时两次 16 通道的读取都不越出分组)：
+ *   左半部分从分组起点读取，通道 t..15 置零，前缀和在尾部重复 P_L(t)；
+ *   右半部分读取以分组终点结尾的 16 个通道，通道 0..15-t 置零，前缀和在头部为 0。
+ * 0 总在 [floor_dc, ceiling_dc] 内 (floor_dc <= 0 <= ceiling_dc)，因此补零不改变判断结果。
+ */
+#define DCC_VECTOR_MIN_HALF 9 // 实测 t <= 8 时逐个累加 (可提前结束) 更快
+#define DCC_VECTOR_MAX_HALF 16
+
+static inline int checkPrefixRange(int min_right, int max_right, int total_right, int min_left, int max_left,
+                                   int floor_dc, int ceiling_dc)
+{
+    return min_right >= floor_dc && max_right <= ceiling_dc &&
+           min_left + total_right >= floor_dc && max_left + total_right <= ceiling_dc;
+}
+
+#ifdef DCCSWAP_X86
+
+// 4 个 int32 通道的前缀和
+__attribute__((target("sse4.1"))) static inline __m128i prefixSum4(__m128i x)
+{
+    x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+    return _mm_add_epi32(x, _mm_slli_si128(x, 8));
+}
+
+// 16 个 int16 通道 (lo, hi) 的前缀和的最小值、最大值与总和
+__attribute__((target("sse4.1"))) static inline void prefixRange16Sse41(__m128i lo, __m128i hi, int &min_sum, int &max_sum, int &total)
+{
+    __m128i q0 = prefixSum4(_mm_cvtepi16_epi32(lo));
+    __m128i q1 = _mm_add_epi32(prefixSum4(_mm_cvtepi16_epi32(_mm_srli_si128(lo, 8))), _mm_shuffle_epi32(q0, 0xFF));
+    __m128i q2 = _mm_add_epi32(prefixSum4(_mm_cvtepi16_epi32(hi)), _mm_shuffle_epi32(q1, 0xFF));
+    __m128i q3 = _mm_add_epi32(prefixSum4(_mm_cvtepi16_epi32(_mm_srli_si128(hi, 8))), _mm_shuffle_epi32(q2, 0xFF));
+
+    __m128i min_q = _mm_min_epi32(_mm_min_epi32(q0, q1), _mm_min_epi32(q2, q3));
+    __m128i max_q = _mm_max_epi32(_mm_max_epi32(q0, q1), _mm_max_epi32(q2, q3));
+    min_q = _mm_min_epi32(min_q, _mm_shuffle_epi32(min_q, 0x4E));
+    min_q = _mm_min_epi32(min_q, _mm_shuffle_epi32(min_q, 0xB1));
+    max_q = _mm_max_epi32(max_q, _mm_shuffle_epi32(max_q, 0x4E));
+    max_q = _mm_max_epi32(max_q, _mm_shuffle_epi32(max_q, 0xB1));
+
+    min_sum = _mm_cvtsi128_si32(min_q);
+    max_sum = _mm_cvtsi128_si32(max_q);
+    total = _mm_extract_epi32(q3, 3);
+}
+
+__attribute__((target("sse4.1"))) static int canSwapSse41(const JCOEF *group_ptr, int half_size, int floor_dc, int ceiling_dc)
+{
+    const __m128i index_lo = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m128i index_hi = _mm_setr_epi16(8, 9, 10, 11, 12, 13, 14, 15);
+
+    // 左半部分：保留通道 0..t-1
+    __m128i keep_first = _mm_set1_epi16(half_size);
+    __m128i left_lo = _mm_and_si128(_mm_loadu_si128((const __m128i *)group_ptr), _mm_cmpgt_epi16(keep_first, index_lo));
+    __m128i left_hi = _mm_and_si128(_mm_loadu_si128((const __m128i *)(group_ptr + 8)), _mm_cmpgt_epi16(keep_first, index_hi));
+
+    // 右半部分：读取以分组终点结尾的 16 个通道，保留通道 16-t..15
+    const JCOEF *right_end = group_ptr + 2 * half_size - DCC_VECTOR_MAX_HALF;
+    __m128i keep_last = _mm_set1_epi16(DCC_VECTOR_MAX_HALF - 1 - half_size);
+    __m128i right_lo = _mm_and_si128(_mm_loadu_si128((const __m128i *)right_end), _mm_cmpgt_epi16(index_lo, keep_last));
+    __m128i right_hi = _mm_and_si128(_mm_loadu_si128((const __m128i *)(right_end + 8)), _mm_cmpgt_epi16(index_hi, keep_last));
+
+    int min_right, max_right, total_right, min_left, max_left, total_left;
+    prefixRange16Sse41(right_lo, right_hi, min_right, max_right, total_right);
+    prefixRange16Sse41(left_lo, left_hi, min_left, max_left, total_left);
+    return checkPrefixRange(min_right, max_right, total_right, min_left, max_left, floor_dc, ceiling_dc);
+}
+
+// 16 个 int16 通道的前缀和的最小值、最大值与总和
+__attribute__((target("avx2"))) static inline void prefixRange16Avx2(__m256i v, int &min_sum, int &max_sum, int &total)
+{
+    __m256i q0 = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(v));
+    __m256i q1 = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(v, 1));
+
+    // 先在两个 128 位半区内各自求前缀和，再把低半区的总和加到高半区
+    q0 = _mm256_add_epi32(q0, _mm256_slli_si256(q0, 4));
+    q1 = _mm256_add_epi32(q1, _mm256_slli_si256(q1, 4));
+    q0 = _mm256_add_epi32(q0, _mm256_slli_si256(q0, 8));
+    q1 = _mm256_add_epi32(q1, _mm256_slli_si256(q1, 8));
+    __m256i low_total0 = _mm256_shuffle_epi32(q0, 0xFF);
+    __m256i low_total1 = _mm256_shuffle_epi32(q1, 0xFF);
+    q0 = _mm256_add_epi32(q0, _mm256_permute2x128_si256(low_total0, low_total0, 0x08));
+    q1 = _mm256_add_epi32(q1, _mm256_permute2x128_si256(low_total1, low_total1, 0x08));
+    q1 = _mm256_add_epi32(q1, _mm256_permutevar8x32_epi32(q0, _mm256_set1_epi32(7)));
+
+    __m256i min_q = _mm256_min_epi32(q0, q1);
+    __m256i max_q = _mm256_max_epi32(q0, q1);
+    __m128i min_h = _mm_min_epi32(_mm256_castsi256_si128(min_q), _mm256_extracti128_si256(min_q, 1));
+    __m128i max_h = _mm_max_epi32(_mm256_castsi256_si128(max_q), _mm256_extracti128_si256(max_q, 1));
+    min_h = _mm_min_epi32(min_h, _mm_shuffle_epi32(min_h, 0x4E));
+    min_h = _mm_min_epi32(min_h, _mm_shuffle_epi32(min_h, 0xB1));
+    max_h = _mm_max_epi32(max_h, _mm_shuffle_epi32(max_h, 0x4E));
+    max_h = _mm_max_epi32(max_h, _mm_shuffle_epi32(max_h, 0xB1));
+
+    min_sum = _mm_cvtsi128_si32(min_h);
+    max_sum = _mm_cvtsi128_si32(max_h);
+    total = _mm256_extract_epi32(q1, 7);
+}
+
+__attribute__((target("avx2"))) static int canSwapAvx2(const JCOEF *group_ptr, int half_size, int floor_dc, int ceiling_dc)
+{
+    const __m256i index = _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+    // 左半部分：保留通道 0..t-1
+    __m256i left = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)group_ptr),
+                                    _mm256_cmpgt_epi16(_mm256_set1_epi16(half_size), index));
+
+    // 右半部分：读取以分组终点结尾的 16 个通道，保留通道 16-t..15
+    __m256i right = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(group_ptr + 2 * half_size - DCC_VECTOR_MAX_HALF)),
+                                     _mm256_cmpgt_epi16(index, _mm256_set1_epi16(DCC_VECTOR_MAX_HALF - 1 - half_size)));
+
+    int min_right, max_right, total_right, min_left, max_left, total_left;
+    prefixRange16Avx2(right, min_right, max_right, total_right);
+    prefixRange16Avx2(left, min_left, max_left, total_left);
+    return checkPrefixRange(min_right, max_right, total_right, min_left, max_left, floor_dc, ceiling_dc);
+}
+
+#endif // DCCSWAP_X86
+
+typedef int (*canSwapKernel)(const JCOEF *, int, int, int);
+
+static canSwapKernel selectCanSwap()
+{
+#ifdef DCCSWAP_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return canSwapAvx2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return canSwapSse41;
+#endif
+    return canSwapScalar;
+}
+
+/**
+ * @brief DCC迭代交换的溢出判断 (先右半部分，后左半部分)
+ * @param group_ptr 分组的起始地址 (左半部分在前，右半部分在后)
+ * @param half_size 每半部分的DCC数量
+ * @param floor_dc DC系数下限
+ * @param ceiling_dc DC系数上限
+ * @return 非0表示可以交换
+ */
+int canSwapDccHalves(const JCOEF *group_ptr, int half_size, int floor_dc, int ceiling_dc)
+{
+    static const canSwapKernel vector_kernel = selectCanSwap();
+
+    // 分组较短时逐个累加更快；超过向量宽度时也退回标量实现
+    if (half_size < DCC_VECTOR_MIN_HALF || half_size > DCC_VECTOR_MAX_HALF)
+        return canSwapScalar(group_ptr, half_size, floor_dc, ceiling_dc);
+    return vector_kernel(group_ptr, half_size, floor_dc, ceiling_dc);
+}
+
+/**
+ * @brief 原地交换分组的左右两半，不分配内存
+ * @param group_ptr 分组的起始地址
+ * @param half_size 每半部分的DCC数量
+ */
+void swapDccHalves(JCOEF *group_ptr, int half_size)
+{
+    std::swap_ranges(group_ptr, group_ptr + half_size, group_ptr + half_size);
+}
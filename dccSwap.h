@@ -0,0 +1,30 @@
+#ifndef DCCSWAP_H
+#define DCCSWAP_H
+
+#include <stdio.h> // jpeglib.h 需要 FILE 与 size_t
+
+#include "jpeglib.h" // JCOEF
+
+// DCC迭代交换时每个并行任务处理的分组数
+#define DCC_SWAP_GRAIN 4096
+
+/**
+ * @brief DCC迭代交换的溢出判断：先累加右半部分再累加左半部分，
+ * 所有部分和都落在 [floor_dc, ceiling_dc] 内时才允许交换两半。
+ * 加密与解密使用同一判断，结果与原逐个累加的实现逐位一致。
+ * @param group_ptr 分组的起始地址 (左半部分在前，右半部分在后)
+ * @param half_size 每半部分的DCC数量 (即迭代次数 iter_time)
+ * @param floor_dc DC系数下限
+ * @param ceiling_dc DC系数上限
+ * @return 非0表示可以交换
+ */
+int canSwapDccHalves(const JCOEF *group_ptr, int half_size, int floor_dc, int ceiling_dc);
+
+/**
+ * @brief 原地交换分组的左右两半，不分配内存
+ * @param group_ptr 分组的起始地址
+ * @param half_size 每半部分的DCC数量
+ */
+void swapDccHalves(JCOEF *group_ptr, int half_size);
+
+#endif // DCCSWAP_H
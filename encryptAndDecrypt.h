@@ -3,20 +3,22 @@
 
 #include <vector>
 #include <stdio.h> // For FILE*
+#include <stdint.h>
 
-#include "jpeglib.h" // 引用 jpeglib 库
-#include "gmpxx.h"   // 引用 GMP++ 库
+#include "jpeglib.h"     // 引用 jpeglib 库
+#include "sort.h"        // 混沌置乱表 ChaoticPermutation
+#include "coefArena.h"   // AC系数缓冲区 CoefArena
+#include "runIndex.h"    // 游程类别索引 RunClassIndex
+#include "keystream.h"   // 方案版本 SchemeVersion
+
+class Key;                 // 密钥类，定义见 key.h
+class WorkStealingPool;    // 工作窃取线程池，定义见 threadPool.h
+class EncryptionWorkspace; // 每个线程复用的临时数据，定义见 encryptionWorkspace.h
+class PermutationCache;    // 置乱表的 LRU 缓存，定义见 permutationCache.h
 
 // 定义布尔类型
 typedef int booltype;
 
-// 随机序列结构体：用于存储排序的随机数及其原始索引
-typedef struct
-{
-    int number;      // 原始索引
-    mpf_class value; // 混沌序列生成的随机数值
-} randSequence;
-
 // 整数对结构体：用于某些置乱中的索引映射
 typedef struct
 {
@@ -24,36 +26,158 @@ typedef struct
     int value;  // 值
 } intPair;
 
-/* 非零AC系数的信息：
- * blockPosition: DCT块的位置
- * zigzagPosition: 在zigzag扫描序列中的位置
- * value: 非零量化AC系数的幅值
+/* 加密方案上下文：
+ * 替代原先定义在 main.cpp 中的可变全局变量，并显式传递给每个置乱/逆置乱函数。
+ * 每个分量使用各自的副本，因此不同分量、不同图像可以在多个线程中同时处理。
  */
-typedef struct
+struct SchemeContext
 {
-    int blockPosition;
-    int zigzagPosition;
-    int value;
-} nonZeroAcInfo;
-
-// 加密函数声明
-void scrambleMcuNoDcc(std::vector<randSequence> &rp, JCOEF **ac_ptr);
-void scrambleSameRunAcc(std::vector<std::vector<randSequence>> &rp, JCOEF **ac_ptr, nonZeroAcInfo **runs_ac_info_ptr, int *runs_ac_num_ptr);
-void dccIterSwap(std::vector<std::vector<randSequence>> &rp, JCOEF *diff_ptr, int *iters_group_num_ptr);
-void scrambleSameSignDccGroup(std::vector<std::vector<intPair>> &rp, JCOEF **groups_diff_ptr, int *groups_diff_num_ptr, size_t group_sum);
-void encrypt(const char *src_name, JCOEF *diff_ptr, JCOEF **ac_ptr);
+    /* 图像通道数 (例如，1代表灰度，3代表YCbCr) */
+    size_t channel = 0;
+
+    /* 当前分量DCT块的宽度 (列数)、高度 (行数) 与总数 */
+    size_t block_width = 0;
+    size_t block_height = 0;
+    size_t block_sum = 0;
+
+    /* 当前分量量化DC系数的有效范围 */
+    int ceiling_dc = 0;
+    int floor_dc = 0;
+
+    /* 将要置乱的游程的最大数量 (0-62) */
+    int ceiling_run = 63;
+
+    /* DCC迭代交换加密的最大迭代次数 */
+    int iter_times = 15;
+
+    /* 混沌序列生成模式 (ChaosMode)，默认与原 GMP 实现兼容 */
+    int chaos_mode = CHAOS_GMP_COMPAT;
+
+    /* 非0时在 pool 的线程上并行处理图像的各个分量，pool 为 NULL 时依次处理 (输出与串行处理逐位相同) */
+    int parallel_components = 0;
+
+    /* 非0时MCU置乱与DCC分组置乱按置换环原地进行，不复制整份数据 (输出逐位相同) */
+    int in_place_permutation = 0;
+
+    /* 密文的熵编码参数：非0时使用优化的 Huffman 表；每隔 restart_interval 个 MCU 插入重启标记 (0 表示不插入)。
+     * 只影响加密输出，解密输出仍按默认参数编码 */
+    int optimize_coding = 0;
+    unsigned int restart_interval = 0;
+
+    /* 非0时优先使用内置的基线JPEG编解码器 (不支持的图像仍由 libjpeg 处理，输出逐位相同) */
+    int fast_codec = 0;
+
+    /* libjpeg 虚拟块数组可使用的内存上限 (字节)，超出的部分交给 libjpeg 的后备存储；0 表示不限制。
+     * 非0时不使用内置编解码器 (它把所有系数保存在内存中) */
+    size_t max_memory = 0;
+
+    /* 图像内部并行使用的线程池 (例如DCC迭代交换的各分组)，NULL 表示串行处理 */
+    WorkStealingPool *pool = NULL;
+
+    /* 置乱表缓存 (加密后再解密同一幅图像、重复解密同一幅密文时复用置乱表)，NULL 表示每次重新生成 */
+    PermutationCache *permutation_cache = NULL;
+};
+
+// 加密函数声明 (run_staging 为暂存所有游程类别系数的缓冲区，group_staging 为暂存DCC的缓冲区)
+void scrambleMcuNoDcc(const SchemeContext &ctx, const ChaoticPermutation &rp, CoefArena &ac_arena);
+void scrambleSameRunAcc(const SchemeContext &ctx, const std::vector<ChaoticPermutation> &rp, JCOEF *ac_ptr, const RunClassIndex &run_index,
+                        std::vector<JCOEF> &run_staging);
+void dccIterSwap(const SchemeContext &ctx, const std::vector<ChaoticPermutation> &rp, JCOEF *diff_ptr, int *iters_group_num_ptr);
+void scrambleSameSignDccGroup(const SchemeContext &ctx, const uint32_t *group_order, const uint32_t *group_offset, size_t group_num,
+                              JCOEF *diff_ptr, JCOEF *group_staging);
+bool encrypt(const SchemeContext &ctx, const Key &key, JCOEF *diff_ptr, CoefArena &ac_arena, EncryptionWorkspace &workspace);
 
 // 解密函数声明
-void reScrambleMcuNoDcc(std::vector<randSequence> &rp, JCOEF **ac_ptr);
-void reScrambleSameRunAcc(std::vector<std::vector<randSequence>> &rp, JCOEF **ac_ptr, nonZeroAcInfo **runs_ac_info_ptr, int *runs_ac_num_ptr);
-void reDccIterSwap(std::vector<std::vector<randSequence>> &rp, JCOEF *diff_ptr, int *iters_group_num_ptr);
-void reScrambleSameSignDccGroup(std::vector<std::vector<intPair>> &rp, JCOEF **groups_diff_ptr, int *groups_diff_num_ptr, size_t group_sum);
-void decrypt(const char *enc_name, JCOEF *diff_ptr, JCOEF **ac_ptr);
+void reScrambleMcuNoDcc(const SchemeContext &ctx, const ChaoticPermutation &rp, CoefArena &ac_arena);
+void reScrambleSameRunAcc(const SchemeContext &ctx, const std::vector<ChaoticPermutation> &rp, JCOEF *ac_ptr, const RunClassIndex &run_index,
+                          std::vector<JCOEF> &run_staging);
+void reDccIterSwap(const SchemeContext &ctx, const std::vector<ChaoticPermutation> &rp, JCOEF *diff_ptr, int *iters_group_num_ptr);
+void reScrambleSameSignDccGroup(const SchemeContext &ctx, const uint32_t *group_order, const uint32_t *group_offset, size_t group_num,
+                                JCOEF *diff_ptr, JCOEF *group_staging);
+bool decrypt(const SchemeContext &ctx, const Key &key, JCOEF *diff_ptr, CoefArena &ac_arena, EncryptionWorkspace &workspace);
+
+/* proposedEncryptionScheme、selfCheckScheme 与 saveJpeg 的结果 */
+enum SchemeStatus
+{
+    SCHEME_OK = 0,
+    SCHEME_OPEN_ERROR,          // 无法打开输入文件
+    SCHEME_DECODE_ERROR,        // 输入不是可以解码的JPEG
+    SCHEME_ENCODE_ERROR,        // 置乱后的系数无法编码
+    SCHEME_WRITE_ERROR,         // 无法写出输出文件
+    SCHEME_UNSUPPORTED_VERSION, // 密文的方案版本不受支持
+    SCHEME_VERIFY_ERROR,        // 校验时解密得到的系数无法重新编码
+    SCHEME_OUT_OF_MEMORY,       // 无法分配系数缓冲区
+    SCHEME_IMAGE_TOO_LARGE      // 分量的块数超过游程类别索引的上限 (RUN_INDEX_MAX_BLOCKS)
+};
+
+// SchemeStatus 的说明文字
+const char *schemeStatusString(int status);
+
+// JPEG系数写出函数：写入任意目标管理器 / 保存到文件 (scheme_version 非0时写出方案版本标记，保存失败时返回 SchemeStatus 并删除输出文件)
+void compressCoefficients(struct jpeg_decompress_struct *cinfo, jvirt_barray_ptr *coeff, struct jpeg_compress_struct *cinfo_enc,
+                         int optimize_coding = 0, unsigned int restart_interval = 0, int scheme_version = SCHEME_VERSION_LEGACY);
+int saveJpeg(struct jpeg_decompress_struct *cinfo, jvirt_barray_ptr *coeff, const char *img_name, size_t size_hint,
+             int optimize_coding = 0, unsigned int restart_interval = 0, int scheme_version = SCHEME_VERSION_LEGACY);
+
+// 加密输出的方案版本 (SchemeVersion)：GMP 兼容模式不写版本标记，密文与旧版本相同
+int schemeVersion(const SchemeContext &options);
+
+// 解密前读取密文中的方案版本标记并相应地设置 options.chaos_mode，版本不受支持时返回 false
+bool applySchemeVersion(const unsigned char *data, size_t size, SchemeContext &options);
+
+// 将系数压缩后与参考数据比较 (不写出)，输出第一个不同字节的偏移 (完全相同时为 -1)；无法编码时返回 SCHEME_VERIFY_ERROR
+int compareJpeg(struct jpeg_decompress_struct *cinfo, jvirt_barray_ptr *coeff, const unsigned char *reference, size_t reference_size,
+                int64_t *mismatch_offset);
+
+/* 一个分量的DCT系数块及其参数 (jpeg_component_info 中加密方案用到的部分)。
+ * 系数完整驻留在内存中时通过 block_array 直接访问；否则按 strip_rows 行的条带访问 libjpeg 的虚拟块数组 */
+typedef struct
+{
+    JBLOCKARRAY block_array;     // 所有块行 (block_array[行][列])，为 NULL 时访问 virt_array
+    jvirt_barray_ptr virt_array; // libjpeg 的虚拟块数组
+    j_common_ptr cinfo;          // virt_array 所属的 libjpeg 对象
+    JDIMENSION strip_rows;       // 每次访问虚拟块数组的块行数 (不超过申请时的 maxaccess)
+    JDIMENSION width_in_blocks;  // 块宽度
+    JDIMENSION height_in_blocks; // 块高度
+    int dc_step;                 // DC系数的量化步长
+} componentBlocks;
+
+// 对各分量的系数块进行加密/解密 (系数可来自 libjpeg 或内置的编解码器)，返回 SchemeStatus
+int transformComponents(const std::vector<componentBlocks> &components, const Key &key, int is_decryption, const SchemeContext &options);
+
+/* fastTransformJpeg 的结果 */
+enum FastCodecResult
+{
+    FAST_CODEC_DONE,         // 已完成
+    FAST_CODEC_UNSUPPORTED,  // 输入不受内置编解码器支持，应改用 libjpeg
+    FAST_CODEC_ENCODE_ERROR, // 置乱后的系数超出内置编码器的范围 (输入未被修改)，应改用 libjpeg
+    FAST_CODEC_OUT_OF_MEMORY // 无法分配系数缓冲区或图像过大 (输入未被修改)，应改用 libjpeg
+};
+
+// 使用内置的基线JPEG编解码器进行内存到内存的加密/解密，返回 FastCodecResult
+int fastTransformJpeg(const unsigned char *src, size_t src_size, int is_decryption, const SchemeContext &options,
+                      std::vector<unsigned char> &output, int64_t *verify_mismatch = NULL);
+
+// 对已读取的DCT系数进行加密/解密，结果写回虚拟块数组；返回 SchemeStatus
+int transformCoefficients(struct jpeg_decompress_struct *cinfo, jvirt_barray_ptr *coeff, int is_decryption, const SchemeContext &options);
+
+/* 系数级自检的结果 */
+typedef struct
+{
+    size_t coef_sum;     // 比较的系数总数
+    size_t mismatch_sum; // 解密后与原始值不相等的系数数量
+    size_t component;    // 第一个不相等系数所在的分量 (mismatch_sum 为 0 时无意义)
+    size_t block_row;    // 第一个不相等系数所在块的行号
+    size_t block_col;    // 第一个不相等系数所在块的列号
+    int coef_index;      // 第一个不相等系数在块内的自然顺序下标 (0 为DC)
+} selfCheckReport;
 
-// JPEG文件保存函数
-void saveJpeg(struct jpeg_decompress_struct *cinfo, jvirt_barray_ptr *coeff, const char *img_name);
+// 系数级自检：加密后立即解密并与原始系数比较，不进行JPEG编码，返回 SchemeStatus
+int selfCheckScheme(const char *src_name, const SchemeContext &options, selfCheckReport *report);
 
-// 整体加密/解密方案的入口函数
-void proposedEncryptionScheme(const char *src_name, const char *dst_name, int is_decryption);
+// 整体加密/解密方案的入口函数，options 提供方案参数，块尺寸等按分量填充；
+// 加密时可通过 verify_mismatch 在内存中解密并与源文件比较；出错时不终止进程，返回 SchemeStatus
+int proposedEncryptionScheme(const char *src_name, const char *dst_name, int is_decryption, const SchemeContext &options,
+                             int64_t *verify_mismatch = NULL);
 
 #endif // ENCRYPTANDDECRYPT_H
\ No newline at end of file
@@ -5,609 +5,744 @@
 #include <math.h>   // For round
 
 #include <vector>
-#include <algorithm> // For std::sort
+#include <algorithm>  // For std::min
 
 #include "jpeglib.h" // JPEG库头文件
-
-#include "encryptAndDecrypt.h" // 自定义的加密解密头文件
-#include "sort.h"              // 排序辅助函数头文件 (尽管实际使用了std::sort)
-#include "key.h"               // 密钥生成头文件
-
-// 外部全局变量声明 (在 main.cpp 中定义)
-extern size_t channel;
-extern size_t block_width;
-extern size_t block_height;
-extern size_t block_sum;
-extern int ceiling_run;
-extern int iter_times;
-extern int ceiling_dc;
-extern int floor_dc;
-extern int zigzag[63]; // Zigzag扫描顺序
+#include "jerror.h"  // JERR_FILE_WRITE
+
+#include "encryptAndDecrypt.h"   // 自定义的加密解密头文件
+#include "sort.h"                // 混沌置乱表 ChaoticPermutation
+#include "permutation.h"         // 原地置换
+#include "zigzag.h"              // zigzag 重排
+#include "runIndex.h"            // 游程类别索引
+#include "key.h"                 // 密钥生成头文件
+#include "dccSwap.h"             // DCC分组左右两半的溢出判断与交换
+#include "dccGroups.h"           // DCC相同符号分组的置乱顺序
+#include "threadPool.h"          // parallelFor
+#include "jpegIo.h"              // 内存映射的输入输出
+#include "fastJpeg.h"            // 内置的基线JPEG编解码器
+#include "encryptionWorkspace.h" // 每个线程复用的临时数据
+#include "permutationCache.h"    // 置乱表缓存
 
 /**
  * @brief 对不包含DCC的MCU进行全局置乱 (AC系数块的置乱)
- * @param rp 排序后的随机序列，用于确定置乱顺序
- * @param ac_ptr 指向所有AC系数块的指针数组
+ * @param ctx 加密方案上下文 (当前分量的块尺寸与方案参数)
+ * @param rp 混沌置乱表，用于确定置乱顺序
+ * @param ac_arena 当前分量所有AC系数块的缓冲区
  */
-void scrambleMcuNoDcc(std::vector<randSequence> &rp, JCOEF **ac_ptr)
+void scrambleMcuNoDcc(const SchemeContext &ctx, const ChaoticPermutation &rp, CoefArena &ac_arena)
 {
-    // 临时存储所有AC系数块的指针，以便进行置乱
-    JCOEF **temp_ac_ptr = (JCOEF **)malloc(sizeof(JCOEF *) * block_sum);
-    if (!temp_ac_ptr)
-    {
-        perror("Failed to allocate memory for temp_ac_ptr");
-        exit(EXIT_FAILURE);
-    }
-
-    // 复制AC系数块到临时数组中
-    for (size_t i = 0; i < block_sum; ++i)
-    {
-        temp_ac_ptr[i] = (JCOEF *)malloc(sizeof(JCOEF) * (DCTSIZE2 - 1));
-        if (!temp_ac_ptr[i])
-        {
-            perror("Failed to allocate memory for temp_ac_ptr[i]");
-            // 释放之前已分配的内存
-            for (size_t k = 0; k < i; ++k)
-                free(temp_ac_ptr[k]);
-            free(temp_ac_ptr);
-            exit(EXIT_FAILURE);
-        }
-        memcpy(temp_ac_ptr[i], ac_ptr[i], sizeof(JCOEF) * (DCTSIZE2 - 1));
-    }
-
-    // 根据排序后的随机序列 rp 进行AC系数块的置乱
-    // rp[i].number 包含了原始位置的索引
-    for (size_t i = 0; i < block_sum; ++i)
+    // 根据置乱表 rp 进行AC系数块的置乱
+    // rp.forward()[i] 包含了原始位置的索引，将原始位置的块收集到后台缓冲区的位置 i
+    const uint32_t *forward = rp.forward();
+    if (ctx.in_place_permutation)
     {
-        size_t original_index = rp[i].number;
-        // 将原始位置为 original_index 的块复制到当前位置 i
-        memcpy(ac_ptr[i], temp_ac_ptr[original_index], sizeof(JCOEF) * (DCTSIZE2 - 1));
+        // 原地模式：沿置换环搬移块，不占用后台缓冲区
+        gatherInPlace(ac_arena.blocks(), ctx.block_sum, [forward](size_t i)
+                      { return (size_t)forward[i]; });
+        return;
     }
 
-    // 释放临时内存
-    for (size_t i = 0; i < block_sum; ++i)
+    const JCOEF *src = ac_arena.data();
+    JCOEF *dst = ac_arena.backData();
+    for (size_t i = 0; i < ctx.block_sum; ++i)
     {
-        free(temp_ac_ptr[i]);
-        temp_ac_ptr[i] = NULL;
+        memcpy(dst + i * AC_STRIDE, src + (size_t)forward[i] * AC_STRIDE, sizeof(JCOEF) * AC_STRIDE);
     }
-    free(temp_ac_ptr);
-    temp_ac_ptr = NULL;
+    ac_arena.swap();
 }
 
 /**
  * @brief 对具有相同游程的AC系数进行全局置乱
- * @param rp 排序后的随机序列，每个游程类别对应一个内部随机序列
- * @param ac_ptr 指向所有AC系数块的指针数组
- * @param runs_ac_info_ptr 存储每个游程类别下非零AC系数的位置和值的详细信息
- * @param runs_ac_num_ptr 存储每个游程类别下非零AC系数的数量
+ * 各游程类别的系数位置互不重叠，所有类别一起按条目分块并行置乱 (见 RunClassIndex::gather())。
+ * @param ctx 加密方案上下文 (当前分量的块尺寸与方案参数)
+ * @param rp 混沌置乱表，每个游程类别对应一个置乱表
+ * @param ac_ptr 当前分量AC系数缓冲区的起始地址 (块间隔为 AC_STRIDE)
+ * @param run_index 每个游程类别下非零AC系数在缓冲区中的位置
+ * @param run_staging 暂存所有游程类别系数的缓冲区 (按需扩大)
  */
-void scrambleSameRunAcc(std::vector<std::vector<randSequence>> &rp, JCOEF **ac_ptr, nonZeroAcInfo **runs_ac_info_ptr, int *runs_ac_num_ptr)
+void scrambleSameRunAcc(const SchemeContext &ctx, const std::vector<ChaoticPermutation> &rp, JCOEF *ac_ptr, const RunClassIndex &run_index,
+                        std::vector<JCOEF> &run_staging)
 {
-    // 遍历所有可能的游程长度 (0 到 ceiling_run-1)
-    for (int run = 0; run < ceiling_run; ++run)
-    {
-        int num_ac_in_run = runs_ac_num_ptr[run]; // 当前游程类别下非零AC系数的数量
-
-        // 如果该游程类别下没有AC系数，则跳过
-        if (num_ac_in_run == 0)
-            continue;
-
-        // 临时存储当前游程类别下所有AC系数的值，以便进行置乱
-        std::vector<JCOEF> temp_ac_values(num_ac_in_run);
-        for (int ac_count = 0; ac_count < num_ac_in_run; ++ac_count)
-        {
-            temp_ac_values[ac_count] = runs_ac_info_ptr[run][ac_count].value;
-        }
-
-        // 根据排序后的随机序列 rp[run] 对 temp_ac_values 进行置乱
-        for (int ac_count = 0; ac_count < num_ac_in_run; ++ac_count)
-        {
-            int original_index = rp[run][ac_count].number; // 原始AC系数在当前游程组中的索引
-
-            // 获取要被置乱的AC系数的原始位置
-            int block_position = runs_ac_info_ptr[run][ac_count].blockPosition;
-            int zigzag_position = runs_ac_info_ptr[run][ac_count].zigzagPosition;
-
-            // 将置乱后的值写入AC系数的原始位置
-            // 值来自 temp_ac_values 的 original_index 位置
-            ac_ptr[block_position][zigzag_position] = temp_ac_values[original_index];
-        }
-    }
+    // 游程类别 run 中第 i 个位置写入原始索引为 rp[run].forward()[i] 的AC系数
+    const uint32_t *forward[DCTSIZE2];
+    for (int run = 0; run < ctx.ceiling_run; ++run)
+        forward[run] = rp[run].forward();
+
+    if (run_staging.size() < run_index.total())
+        run_staging.resize(run_index.total());
+    run_index.gather(ctx.pool, forward, ac_ptr, run_staging.data());
 }
 
 /**
  * @brief 对相同正负符号的DCC分组进行置乱
- * @param rp 排序后的随机序列，每个DCC组对应一个内部随机序列
- * @param groups_diff_ptr 指向DCC分组的指针数组
- * @param groups_diff_num_ptr 存储每个DCC分组中DCC的数量
- * @param group_sum DCC分组的总数 (实际分组数量为 group_sum + 1)
+ * 直接在DCC序列上进行，各分组互不重叠，使用线程池并行处理。
+ * @param ctx 加密方案上下文 (当前分量的块尺寸与方案参数)
+ * @param group_order 各分组内的置乱顺序 (见 deriveGroupOrder())，分组 g 的顺序从 group_offset[g] 开始
+ * @param group_offset 各分组的起始位置 (group_num + 1 项)
+ * @param group_num 分组数量
+ * @param diff_ptr 指向所有DCC差分系数的指针
+ * @param group_staging 暂存DCC的缓冲区 (与 diff_ptr 等长，原地模式下不使用)
  */
-void scrambleSameSignDccGroup(std::vector<std::vector<intPair>> &rp, JCOEF **groups_diff_ptr, int *groups_diff_num_ptr, size_t group_sum)
+void scrambleSameSignDccGroup(const SchemeContext &ctx, const uint32_t *group_order, const uint32_t *group_offset, size_t group_num,
+                              JCOEF *diff_ptr, JCOEF *group_staging)
 {
-    // 遍历所有DCC分组
-    for (size_t group_index = 0; group_index <= group_sum; ++group_index)
-    {
-        int group_diff_num = groups_diff_num_ptr[group_index]; // 当前分组中DCC的数量
-
-        // 如果分组中只有一个DCC，则无需置乱
-        if (group_diff_num == 1)
+    parallelFor(ctx.pool, 0, group_num, DCC_GROUP_GRAIN, [&](size_t group_begin, size_t group_end)
+                {
+        // 非原地模式：先把本任务负责的连续一段DCC复制到暂存区的相同位置，再按分组收集回来
+        if (!ctx.in_place_permutation)
         {
-            continue;
+            size_t first = group_offset[group_begin];
+            memcpy(group_staging + first, diff_ptr + first, sizeof(JCOEF) * (group_offset[group_end] - first));
         }
-        else
+
+        for (size_t group_index = group_begin; group_index < group_end; ++group_index)
         {
-            // 临时存储当前分组中的DCC值，以便进行置乱
-            JCOEF *group_dc_temp = (JCOEF *)malloc(sizeof(JCOEF) * group_diff_num);
-            if (!group_dc_temp)
+            size_t offset = group_offset[group_index];
+            size_t group_diff_num = group_offset[group_index + 1] - offset; // 当前分组中DCC的数量
+            const uint32_t *group_rp = group_order + offset;                // 当前分组的置乱顺序
+            JCOEF *group_ptr = diff_ptr + offset;
+
+            // 如果分组中只有一个DCC，则无需置乱
+            if (group_diff_num <= 1)
+                continue;
+
+            if (ctx.in_place_permutation)
             {
-                perror("Failed to allocate memory for group_dc_temp");
-                exit(EXIT_FAILURE);
+                // 原地模式：沿置换环搬移DCC
+                gatherInPlace(group_ptr, group_diff_num, [group_rp](size_t i)
+                              { return (size_t)group_rp[i]; });
             }
-            memcpy(group_dc_temp, groups_diff_ptr[group_index], sizeof(JCOEF) * group_diff_num);
-
-            // 根据排序后的随机序列 rp[group_index] 对分组进行置乱
-            // rp[group_index][diff_index].number 包含了原始位置的索引
-            for (int diff_index = 0; diff_index < group_diff_num; ++diff_index)
+            else
             {
-                int original_index = rp[group_index][diff_index].number; // 原始DCC在该组中的索引
-                // 将原始位置为 original_index 的DCC值写入当前分组的 diff_index 位置
-                groups_diff_ptr[group_index][diff_index] = group_dc_temp[original_index];
+                // group_rp[diff_index] 为写入位置 diff_index 的DCC在该组中的原始索引
+                const JCOEF *group_src = group_staging + offset;
+                for (size_t diff_index = 0; diff_index < group_diff_num; ++diff_index)
+                    group_ptr[diff_index] = group_src[group_rp[diff_index]];
             }
-
-            // 释放临时内存
-            free(group_dc_temp);
-            group_dc_temp = NULL;
-        }
-    }
+        } });
 }
 
 /**
  * @brief DCC分组迭代交换加密
- * @param rp 排序后的随机序列，用于交换决策
+ * @param ctx 加密方案上下文 (当前分量的块尺寸与方案参数)
+ * @param rp 每次迭代的混沌置乱表，用于交换决策
  * @param diff_ptr 指向所有DCC差分系数的指针
  * @param iters_group_num_ptr 存储每次迭代中分组的数量
  */
-void dccIterSwap(std::vector<std::vector<randSequence>> &rp, JCOEF *diff_ptr, int *iters_group_num_ptr)
+void dccIterSwap(const SchemeContext &ctx, const std::vector<ChaoticPermutation> &rp, JCOEF *diff_ptr, int *iters_group_num_ptr)
 {
     // 遍历所有迭代次数
-    for (int iter_time = 1; iter_time <= iter_times; ++iter_time)
+    for (int iter_time = 1; iter_time <= ctx.iter_times; ++iter_time)
     {
         int group_num_current_iter = iters_group_num_ptr[iter_time - 1]; // 当前迭代中的分组数量
+        const uint32_t *forward = rp[iter_time - 1].forward();
 
-        // 遍历当前迭代中的每个分组
-        for (int group_index = 0; group_index < group_num_current_iter; ++group_index)
-        {
-            int prev_dc = 0;       // 用于累计DC值以判断溢出
-            booltype can_swap = 1; // 标记当前分组是否可以交换 (默认为可交换)
-
-            // 从随机序列中获取当前分组的交换决策值
-            int swap_decision_number = rp[iter_time - 1][group_index].number;
-
-            // --- 检查右半部分是否引起溢出 ---
-            // 右半部分的起始索引和结束索引
-            size_t right_part_start_idx = 2 * iter_time * group_index + iter_time;
-            size_t right_part_end_idx = 2 * (group_index + 1) * iter_time;
-
-            for (size_t diff_idx = right_part_start_idx; diff_idx < right_part_end_idx; ++diff_idx)
-            {
-                if (can_swap == 1)
-                { // 只有在之前没有溢出的情况下才进行溢出判断
-                    prev_dc += diff_ptr[diff_idx];
-                    // 检查DC值是否在有效范围内
-                    if (!(prev_dc <= ceiling_dc && prev_dc >= floor_dc))
-                    {
-                        can_swap = 0; // 发生溢出，标记为不可交换
-                    }
-                }
-                else
-                { // 已经溢出，继续累加DC值但不进行判断
-                    prev_dc += diff_ptr[diff_idx];
-                }
-            }
-
-            // --- 检查左半部分是否引起溢出 ---
-            // 左半部分的起始索引和结束索引
-            size_t left_part_start_idx = 2 * iter_time * group_index;
-            size_t left_part_end_idx = 2 * iter_time * group_index + iter_time;
-
-            for (size_t diff_idx = left_part_start_idx; diff_idx < left_part_end_idx; ++diff_idx)
-            {
-                if (can_swap == 1)
-                { // 只有在之前没有溢出的情况下才进行溢出判断
-                    prev_dc += diff_ptr[diff_idx];
-                    // 检查DC值是否在有效范围内
-                    if (!(prev_dc <= ceiling_dc && prev_dc >= floor_dc))
+        // 同一次迭代中的分组互不重叠，可以并行处理；不同迭代之间必须按顺序进行
+        parallelFor(ctx.pool, 0, group_num_current_iter, DCC_SWAP_GRAIN, [&](size_t group_begin, size_t group_end)
                     {
-                        can_swap = 0; // 发生溢出，标记为不可交换
-                    }
-                }
-                else
-                { // 已经溢出，继续累加DC值但不进行判断
-                    prev_dc += diff_ptr[diff_idx];
-                }
-            }
-
-            // --- 执行交换操作（如果可交换且决策为交换） ---
-            if (can_swap == 1)
+            for (size_t group_index = group_begin; group_index < group_end; ++group_index)
             {
-                // 如果随机决策值为奇数，则进行交换
-                if (swap_decision_number % 2 == 1)
+                // 随机决策值为奇数，且交换不会引起DC溢出时，交换分组的左右两半
+                JCOEF *group_ptr = diff_ptr + 2 * iter_time * group_index;
+                if (forward[group_index] % 2 == 1 && canSwapDccHalves(group_ptr, iter_time, ctx.floor_dc, ctx.ceiling_dc))
                 {
-                    JCOEF *left_part_temp = (JCOEF *)malloc(sizeof(JCOEF) * iter_time);
-                    if (!left_part_temp)
-                    {
-                        perror("Failed to allocate memory for left_part_temp");
-                        exit(EXIT_FAILURE);
-                    }
-
-                    // 复制左半部分到临时变量
-                    memcpy(left_part_temp, diff_ptr + left_part_start_idx, sizeof(JCOEF) * iter_time);
-                    // 将右半部分复制到左半部分的位置
-                    memcpy(diff_ptr + left_part_start_idx, diff_ptr + right_part_start_idx, sizeof(JCOEF) * iter_time);
-                    // 将临时变量（原左半部分）复制到右半部分的位置
-                    memcpy(diff_ptr + right_part_start_idx, left_part_temp, sizeof(JCOEF) * iter_time);
-
-                    free(left_part_temp);
-                    left_part_temp = NULL;
+                    swapDccHalves(group_ptr, iter_time);
                 }
-            }
-        }
+            } });
     }
 }
 
 /**
  * @brief 对JPEG图像进行加密的主函数
- * @param src_name 原始图像文件名 (用于密钥生成)
+ * @param ctx 加密方案上下文 (当前分量的块尺寸与方案参数)
+ * @param key 由原始图像特征生成的密钥 (每幅图像计算一次，所有分量共用)
  * @param diff_ptr 指向所有DC差分系数的指针
- * @param ac_ptr 指向所有AC系数块的指针数组
+ * @param ac_arena 当前分量所有AC系数块的缓冲区
+ * @param workspace 当前线程的临时数据 (已按当前分量调用 prepare())
+ * @return 块数超过 RUN_INDEX_MAX_BLOCKS 时返回 false (系数未被修改)
  */
-void encrypt(const char *src_name, JCOEF *diff_ptr, JCOEF **ac_ptr)
+bool encrypt(const SchemeContext &ctx, const Key &key, JCOEF *diff_ptr, CoefArena &ac_arena, EncryptionWorkspace &workspace)
 {
-    // 使用图像文件名初始化 Key 类，生成混沌序列的初始参数 x 和 u
-    Key key(src_name);
-    mpf_class x = key.getX();
-    mpf_class u = key.getU();
+    // 一次遍历生成每块的非零位图，统计每个游程长度下非零AC系数的数量 (DCC的置乱不改变AC系数)
+    RunClassIndex &run_index = workspace.run_index;
+    if (!run_index.scan(ac_arena.data(), ctx.block_sum, ctx.ceiling_run))
+        return false;
 
-    // 用于生成随机序列的临时 randSequence 结构体
-    randSequence r;
+    // 生成全部置乱表，或从缓存中取得解密/加密同一幅图像时生成的置乱表
+    std::shared_ptr<const PermutationTables> cached_tables;
+    const PermutationTables &tables = obtainPermutationTables(ctx, key, run_index, workspace.tables, cached_tables);
 
     /*************************************************** scrambleSameSignDccGroup ***********************************************************/
-    // 1. 分割DCC序列为相同符号的分组
-    size_t group_sum = 0;           // 实际分组数量为 group_sum + 1
-    int group_diff_num_current = 0; // 当前分组中的DCC数量
-    booltype current_sign;          // 当前DCC分组的符号 (1为正，0为负)
-
-    // 分配内存来存储每个分组中DCC的数量
-    int *groups_diff_num_ptr = (int *)malloc(sizeof(int) * block_sum);
-    if (!groups_diff_num_ptr)
+    // 1. 分割DCC序列为相同符号的分组，记录各分组的起始位置
+    uint32_t *group_offset = workspace.group_offset.data();
+    size_t group_num = splitSameSignGroups(diff_ptr, ctx.block_sum, group_offset);
+
+    // 2. 由DCC相同符号置乱的混沌置乱表一次导出每个分组内的置乱顺序
+    uint32_t *group_order = workspace.group_order.data();
+    deriveGroupOrder(tables.dcc_sign.inverse(), ctx.block_sum, group_offset, group_num, workspace.group_of.data(),
+                     workspace.group_cursor.data(), group_order);
+
+    // 3. 直接在DCC序列上执行DCC相同符号置乱
+    scrambleSameSignDccGroup(ctx, group_order, group_offset, group_num, diff_ptr, workspace.group_staging.data());
+
+    /********************************************************** DccIterSwap *****************************************************************/
+    // 1. 每次迭代中DCC分组的数量
+    int *iters_group_num_ptr = workspace.iter_group_num.data();
+
+    for (int iter_time_val = 1; iter_time_val <= ctx.iter_times; ++iter_time_val)
     {
-        perror("Failed to allocate memory for groups_diff_num_ptr");
-        exit(EXIT_FAILURE);
+        iters_group_num_ptr[iter_time_val - 1] = ctx.block_sum / (iter_time_val * 2); // 计算当前迭代的分组数量
     }
-    memset(groups_diff_num_ptr, 0, sizeof(int) * block_sum);
 
-    // 遍历所有DCC，进行分组
-    for (size_t block_idx = 0; block_idx < block_sum; ++block_idx)
+    // 2. 按每次迭代的混沌置乱表执行DCC分组迭代交换
+    dccIterSwap(ctx, tables.dcc_iter, diff_ptr, iters_group_num_ptr);
+
+    /****************************************************** scrambleSameRunAcc **************************************************************/
+    // 记录非零AC系数的位置，并按每个游程类别的混沌置乱表执行ACC相同游程置乱
+    run_index.buildEntries();
+    scrambleSameRunAcc(ctx, tables.run_class, ac_arena.data(), run_index, workspace.run_staging);
+
+    /***************************************************** scrambleMcuNoDcc ***************************************************************/
+    // 执行MCU全局置乱
+    scrambleMcuNoDcc(ctx, tables.mcu, ac_arena);
+    return true;
+}
+
+/**
+ * @brief 将修改后的JPEG系数写入已设置好目标管理器的压缩结构体
+ * 只复制关键参数并直接写入系数，不重新量化，因此不引入额外损失。
+ * @param cinfo 指向JPEG解压缩信息结构体的指针 (用于复制参数)
+ * @param coeff 指向虚拟块数组的指针 (包含修改后的系数)
+ * @param cinfo_enc 已创建并设置目标管理器的压缩结构体
+ * @param optimize_coding 非0时统计符号频率并使用优化的 Huffman 表 (多一遍扫描)
+ * @param restart_interval 每隔多少个 MCU 插入重启标记，0 表示不插入
+ * @param scheme_version 方案版本 (SchemeVersion)，非0时在 JFIF 标记之后写出方案版本标记
+ */
+void compressCoefficients(struct jpeg_decompress_struct *cinfo, jvirt_barray_ptr *coeff, struct jpeg_compress_struct *cinfo_enc,
+                          int optimize_coding, unsigned int restart_interval, int scheme_version)
+{
+    // 复制原始JPEG文件的关键参数到压缩结构体，确保格式兼容性
+    jpeg_copy_critical_parameters((j_decompress_ptr)cinfo, cinfo_enc);
+
+    // 熵编码参数不属于关键参数，需在复制之后设置
+    cinfo_enc->optimize_coding = optimize_coding ? TRUE : FALSE;
+    cinfo_enc->restart_interval = restart_interval;
+
+    // 写入加密后的系数
+    jpeg_write_coefficients(cinfo_enc, coeff);
+
+    // 附加标记只能在 jpeg_write_coefficients 写出文件头之后、jpeg_finish_compress 之前写入
+    if (scheme_version != SCHEME_VERSION_LEGACY)
     {
-        if (block_idx == 0)
-        { // 第一个DCC用于初始化符号
-            current_sign = (diff_ptr[block_idx] >= 0) ? 1 : 0;
-            group_diff_num_current = 1;
-        }
-        else
-        {
-            // 如果当前DCC与前一个DCC符号相同
-            if ((diff_ptr[block_idx] >= 0 && current_sign == 1) || (diff_ptr[block_idx] < 0 && current_sign == 0))
-            {
-                ++group_diff_num_current;
-            }
-            else
-            {                                                            // 符号不同，开始新的分组
-                groups_diff_num_ptr[group_sum] = group_diff_num_current; // 存储前一个分组的数量
-                group_diff_num_current = 1;                              // 新分组的DCC数量从1开始
-                current_sign = !current_sign;                            // 切换符号
-                ++group_sum;                                             // 分组总数加1
-            }
-        }
+        unsigned char payload[SCHEME_MARKER_LENGTH];
+        schemeMarkerPayload(scheme_version, payload);
+        jpeg_write_marker(cinfo_enc, JPEG_APP0 + 11, payload, SCHEME_MARKER_LENGTH);
     }
-    groups_diff_num_ptr[group_sum] = group_diff_num_current; // 存储最后一个分组的数量
 
-    // 2. 复制DCC分组到动态数组中
-    JCOEF **groups_diff_ptr = (JCOEF **)malloc(sizeof(JCOEF *) * (group_sum + 1));
-    if (!groups_diff_ptr)
+    jpeg_finish_compress(cinfo_enc);
+}
+
+/**
+ * @brief 将修改后的JPEG系数保存到文件
+ * 输出文件按预估大小预先分配并映射，libjpeg 直接写入映射区。
+ * @param cinfo 指向JPEG解压缩信息结构体的指针 (用于复制参数)
+ * @param coeff 指向虚拟块数组的指针 (包含修改后的系数)
+ * @param img_name 输出图像的文件名
+ * @param size_hint 预估的输出大小 (例如输入文件大小)，不足时自动扩大
+ * @param optimize_coding 非0时使用优化的 Huffman 表
+ * @param restart_interval 重启间隔 (MCU 数)，0 表示不插入重启标记
+ * @param scheme_version 方案版本 (SchemeVersion)，非0时写出方案版本标记
+ * @return SCHEME_OK，或 SCHEME_WRITE_ERROR / SCHEME_ENCODE_ERROR (此时删除不完整的输出文件)
+ */
+int saveJpeg(struct jpeg_decompress_struct *cinfo, jvirt_barray_ptr *coeff, const char *img_name, size_t size_hint,
+             int optimize_coding, unsigned int restart_interval, int scheme_version)
+{
+    struct jpeg_compress_struct cinfo_enc;
+    jpegJumpErrorMgr jerr_enc;
+    MappedOutput output;
+    if (!output.open(img_name, size_hint))
+        return SCHEME_WRITE_ERROR;
+
+    cinfo_enc.err = jpegJumpError(&jerr_enc);
+    jpeg_create_compress(&cinfo_enc);
+    if (setjmp(jerr_enc.setjmp_buffer))
     {
-        perror("Failed to allocate memory for groups_diff_ptr");
-        free(groups_diff_num_ptr);
-        exit(EXIT_FAILURE);
+        // 写出失败 (JERR_FILE_WRITE) 或系数超出基线JPEG的范围
+        int status = jerr_enc.pub.msg_code == JERR_FILE_WRITE ? SCHEME_WRITE_ERROR : SCHEME_ENCODE_ERROR;
+        jpeg_destroy_compress(&cinfo_enc);
+        remove(img_name);
+        return status;
     }
-    int diff_index_offset = 0;
-    for (size_t group_idx = 0; group_idx <= group_sum; ++group_idx)
+    jpegMappedDest(&cinfo_enc, output);
+
+    compressCoefficients(cinfo, coeff, &cinfo_enc, optimize_coding, restart_interval, scheme_version); // 结束时截断为实际长度并关闭文件
+
+    jpeg_destroy_compress(&cinfo_enc);
+    return SCHEME_OK;
+}
+
+/**
+ * @brief 加密输出对应的方案版本
+ * @param options 方案参数
+ * @return 密钥流模式为 SCHEME_VERSION_KEYSTREAM，定点数混沌模式为 SCHEME_VERSION_FIXED128，
+ *         GMP 兼容模式为 SCHEME_VERSION_LEGACY (不写标记，与旧版本输出相同)
+ */
+int schemeVersion(const SchemeContext &options)
+{
+    switch (options.chaos_mode)
     {
-        int num_in_group = groups_diff_num_ptr[group_idx];
-        groups_diff_ptr[group_idx] = (JCOEF *)malloc(sizeof(JCOEF) * num_in_group);
-        if (!groups_diff_ptr[group_idx])
-        {
-            perror("Failed to allocate memory for groups_diff_ptr[group_idx]");
-            // 释放之前已分配的内存
-            for (size_t k = 0; k < group_idx; ++k)
-                free(groups_diff_ptr[k]);
-            free(groups_diff_ptr);
-            free(groups_diff_num_ptr);
-            exit(EXIT_FAILURE);
-        }
-        memcpy(groups_diff_ptr[group_idx], diff_ptr + diff_index_offset, sizeof(JCOEF) * num_in_group);
-        diff_index_offset += num_in_group;
+    case CHAOS_KEYSTREAM:
+        return SCHEME_VERSION_KEYSTREAM;
+    case CHAOS_FIXED128:
+        return SCHEME_VERSION_FIXED128;
+    default:
+        return SCHEME_VERSION_LEGACY;
     }
+}
 
-    // 3. 生成用于DCC相同符号置乱的随机序列
-    std::vector<randSequence> temp_rp1;
-    for (size_t i = 0; i < block_sum; ++i)
+/**
+ * @brief 解密前读取密文中的方案版本标记并相应地设置随机来源
+ * 没有标记的密文保持调用者指定的混沌模式不变。
+ * @param data 密文JPEG数据
+ * @param size 数据的字节数
+ * @param options 方案参数 (可能修改 chaos_mode)
+ * @return 版本受支持时返回 true
+ */
+bool applySchemeVersion(const unsigned char *data, size_t size, SchemeContext &options)
+{
+    switch (readSchemeVersion(data, size))
     {
-        x = u * x * (1 - x); // Logistic Map 混沌序列生成
-        r.number = i;
-        r.value = x;
-        temp_rp1.push_back(r);
+    case SCHEME_VERSION_LEGACY:
+        return true;
+    case SCHEME_VERSION_KEYSTREAM:
+        options.chaos_mode = CHAOS_KEYSTREAM;
+        return true;
+    case SCHEME_VERSION_FIXED128:
+        options.chaos_mode = CHAOS_FIXED128;
+        return true;
+    default:
+        return false;
     }
-    // 对生成的随机序列按值进行排序
-    std::sort(temp_rp1.begin(), temp_rp1.end(), [](const randSequence &lhs, const randSequence &rhs)
-              { return lhs.value < rhs.value; });
-
-    // 4. 将随机序列分配到每个DCC分组中
-    std::vector<std::vector<intPair>> rp1(group_sum + 1);
-    int rand_index_counter = 0;
-    for (size_t group_idx = 0; group_idx <= group_sum; ++group_idx)
-    {
-        int num_in_group = groups_diff_num_ptr[group_idx];
-        assert(num_in_group >= 1); // 确保每个分组至少有一个DCC
+}
 
-        for (int diff_idx = 0; diff_idx < num_in_group; ++diff_idx)
-        {
-            intPair ip;
-            ip.number = diff_idx;                           // 原始索引
-            ip.value = temp_rp1[rand_index_counter].number; // 排序后的随机序列中的原始索引
-            rp1[group_idx].push_back(ip);
-            ++rand_index_counter;
-        }
-        // 对每个分组内的 intPair 序列按值进行排序
-        std::sort(rp1[group_idx].begin(), rp1[group_idx].end(), [](const intPair &lhs, const intPair &rhs)
-                  { return lhs.value < rhs.value; });
+/**
+ * @brief 将系数压缩后逐块与参考数据比较，不写出文件，发现第一个不同字节即停止
+ * @param cinfo 指向JPEG解压缩信息结构体的指针 (用于复制参数)
+ * @param coeff 指向虚拟块数组的指针
+ * @param reference 参考数据 (例如原始文件的映射区)
+ * @param reference_size 参考数据的字节数
+ * @param mismatch_offset 输出：第一个不同字节的偏移，完全相同时为 -1
+ * @return SCHEME_OK，或 SCHEME_VERIFY_ERROR (系数超出基线JPEG的范围等无法编码的情况，此时 mismatch_offset 无意义)
+ */
+int compareJpeg(struct jpeg_decompress_struct *cinfo, jvirt_barray_ptr *coeff, const unsigned char *reference, size_t reference_size,
+                int64_t *mismatch_offset)
+{
+    struct jpeg_compress_struct cinfo_enc;
+    jpegJumpErrorMgr jerr_enc;
+    compareTarget target;
+    target.reference = reference;
+    target.reference_size = reference_size;
+    target.mismatch_offset = -1;
+
+    // 编码出错 (例如解密得到的DC系数超出范围，JERR_BAD_DCT_COEF) 时跳回这里，与发现不同时的 stop_point 相互独立
+    cinfo_enc.err = jpegJumpError(&jerr_enc);
+    jpeg_create_compress(&cinfo_enc);
+    if (setjmp(jerr_enc.setjmp_buffer))
+    {
+        jpeg_destroy_compress(&cinfo_enc);
+        return SCHEME_VERIFY_ERROR;
     }
+    jpegCompareDest(&cinfo_enc, target);
+
+    // 发现不同时比较目标管理器直接跳回这里，未完成的压缩由 jpeg_destroy_compress 一并中止
+    if (setjmp(target.stop_point) == 0)
+        compressCoefficients(cinfo, coeff, &cinfo_enc);
 
-    // 5. 执行DCC相同符号置乱
-    scrambleSameSignDccGroup(rp1, groups_diff_ptr, groups_diff_num_ptr, group_sum);
+    jpeg_destroy_compress(&cinfo_enc);
+    *mismatch_offset = target.mismatch_offset;
+    return SCHEME_OK;
+}
 
-    // 6. 将置乱后的DCC分组写回到原始的diff_ptr中
-    diff_index_offset = 0;
-    for (size_t group_idx = 0; group_idx <= group_sum; ++group_idx)
+/**
+ * @brief 取得分量中从 start_row 开始的一个条带的块行
+ * 虚拟块数组每次只能访问不超过 maxaccess 行，返回的块行在下一次访问同一数组前有效；
+ * 超出内存上限的部分由 libjpeg 在访问时从后备存储换入、换出。
+ * 后备存储读写失败时 libjpeg 的错误处理会跳回调用者设置的 setjmp，因此只能在设置 setjmp 的线程上调用。
+ * @param blocks 分量的系数块
+ * @param start_row 条带的第一个块行 (为 strip_rows 的整数倍)
+ * @param writable 是否会修改条带中的系数
+ * @return 条带的块行，第 0 行对应 start_row
+ */
+static JBLOCKARRAY accessStrip(const componentBlocks &blocks, JDIMENSION start_row, boolean writable)
+{
+    if (blocks.block_array)
+        return blocks.block_array + start_row;
+
+    return (blocks.cinfo->mem->access_virt_barray)(blocks.cinfo, blocks.virt_array, start_row, blocks.strip_rows, writable);
+}
+
+/**
+ * @brief 读入一个分量：提取DC差分与AC系数
+ * 块数组按条带逐行访问，第 h 行第 w 列的块直接放到它在遍历顺序中的位置：
+ * 多通道图像的Y分量按 2x2 的MCU遍历 (4:2:0 中一个Cb/Cr块对应的4个Y块)，其余分量按行遍历。
+ * 访问虚拟块数组可能触发 libjpeg 的错误处理，只能在设置 setjmp 的线程上调用。
+ * @param ctx 当前分量的加密方案上下文 (块尺寸已填充)
+ * @param blocks 当前分量的DCT系数块
+ * @param co 分量序号
+ * @param data 输出：DC差分系数与AC系数块 (已按块数准备)
+ */
+static void loadComponent(const SchemeContext &ctx, const componentBlocks &blocks, size_t co, componentData &data)
+{
+    JCOEF *diff_ptr = data.diff.data();
+    CoefArena &ac_arena = data.ac_arena;
+    bool mcu_order = (co == 0 && ctx.channel > 1); // 亮度分量，且是多通道图像
+
+    // 分离DC和AC系数：先按遍历顺序存放DC系数，AC系数整块重排为zigzag顺序 (位于通道 0..62)
+    for (JDIMENSION strip_row = 0; strip_row < ctx.block_height; strip_row += blocks.strip_rows)
     {
-        int num_in_group = groups_diff_num_ptr[group_idx];
-        if (num_in_group == 1)
-        { // 如果分组中只有一个DCC，则直接跳过
-            ++diff_index_offset;
-        }
-        else
+        JBLOCKARRAY strip = accessStrip(blocks, strip_row, FALSE);
+        for (JDIMENSION h = strip_row; h < ctx.block_height && h < strip_row + blocks.strip_rows; ++h)
         {
-            memcpy(diff_ptr + diff_index_offset, groups_diff_ptr[group_idx], sizeof(JCOEF) * num_in_group);
-            diff_index_offset += num_in_group;
+            JBLOCKROW row = strip[h - strip_row];
+            size_t row_base = mcu_order ? (size_t)(h / 2) * ctx.block_width * 2 + (h % 2) * 2 : (size_t)h * ctx.block_width;
+            for (JDIMENSION w = 0; w < ctx.block_width; ++w)
+            {
+                size_t block_index = mcu_order ? row_base + 2 * (w & ~1u) + (w & 1) : row_base + w;
+                diff_ptr[block_index] = row[w][0];
+                blockToZigzag(row[w], ac_arena.block(block_index));
+            }
         }
     }
 
-    // 7. 释放为DCC分组分配的内存
-    for (size_t group_idx = 0; group_idx <= group_sum; ++group_idx)
+    // 由DC系数计算差分 (从后向前原地进行，第一个块与 0 作差分)
+    for (size_t block_index = ctx.block_sum; block_index-- > 1;)
     {
-        free(groups_diff_ptr[group_idx]);
-        groups_diff_ptr[group_idx] = NULL;
+        diff_ptr[block_index] = diff_ptr[block_index] - diff_ptr[block_index - 1];
     }
-    free(groups_diff_ptr);
-    groups_diff_ptr = NULL;
-    free(groups_diff_num_ptr);
-    groups_diff_num_ptr = NULL;
+}
 
-    /********************************************************** DccIterSwap *****************************************************************/
-    // 1. 分配内存来存储每次迭代中DCC分组的数量
-    int *iters_group_num_ptr = (int *)malloc(sizeof(int) * iter_times);
-    if (!iters_group_num_ptr)
+/**
+ * @brief 对已读入的一个分量进行加密或解密
+ * 不访问块数组，也不调用 libjpeg；置乱用到的临时数据由当前线程的工作区提供，因此可以在任意线程中调用。
+ * @param ctx 当前分量的加密方案上下文 (块尺寸与DC范围已填充)
+ * @param key 图像密钥 (所有分量共用)
+ * @param data 当前分量的DC差分系数与AC系数块，结果原地写回
+ * @param is_decryption 标志，0表示加密，1表示解密
+ * @return 块数超过 RUN_INDEX_MAX_BLOCKS 时返回 false (数据未被修改)
+ */
+static bool scrambleComponent(const SchemeContext &ctx, const Key &key, componentData &data, int is_decryption)
+{
+    EncryptionWorkspace &workspace = EncryptionWorkspace::local();
+    workspace.prepare(ctx.block_sum, ctx.iter_times);
+
+    // 调用加密或解密函数
+    if (!is_decryption)
     {
-        perror("Failed to allocate memory for iters_group_num_ptr");
-        exit(EXIT_FAILURE);
+        return encrypt(ctx, key, data.diff.data(), data.ac_arena, workspace);
     }
-
-    // 2. 为每次迭代生成随机序列
-    std::vector<std::vector<randSequence>> rp2(iter_times);
-    for (int iter_time_val = 1; iter_time_val <= iter_times; ++iter_time_val)
+    else
     {
-        int group_num_iter = block_sum / (iter_time_val * 2); // 计算当前迭代的分组数量
-        iters_group_num_ptr[iter_time_val - 1] = group_num_iter;
-
-        for (int group_idx = 0; group_idx < group_num_iter; ++group_idx)
-        {
-            x = u * x * (1 - x); // 继续生成混沌序列
-            r.number = group_idx;
-            r.value = x;
-            rp2[iter_time_val - 1].push_back(r);
-        }
-        // 对每个迭代的随机序列按值进行排序
-        std::sort(rp2[iter_time_val - 1].begin(), rp2[iter_time_val - 1].end(), [](const randSequence &lhs, const randSequence &rhs)
-                  { return lhs.value < rhs.value; });
+        return decrypt(ctx, key, data.diff.data(), data.ac_arena, workspace);
     }
+}
 
-    // 3. 执行DCC分组迭代交换
-    dccIterSwap(rp2, diff_ptr, iters_group_num_ptr);
-
-    // 4. 释放内存
-    free(iters_group_num_ptr);
-    iters_group_num_ptr = NULL;
+/**
+ * @brief 将加密/解密后的一个分量写回块数组 (遍历顺序与 loadComponent 相同)
+ * 访问虚拟块数组可能触发 libjpeg 的错误处理，只能在设置 setjmp 的线程上调用。
+ * @param ctx 当前分量的加密方案上下文
+ * @param blocks 当前分量的DCT系数块
+ * @param co 分量序号
+ * @param data 当前分量的DC差分系数与AC系数块 (DC差分在此原地恢复为DC系数)
+ */
+static void storeComponent(const SchemeContext &ctx, const componentBlocks &blocks, size_t co, componentData &data)
+{
+    JCOEF *diff_ptr = data.diff.data();
+    CoefArena &ac_arena = data.ac_arena;
+    bool mcu_order = (co == 0 && ctx.channel > 1);
 
-    /****************************************************** scrambleSameRunAcc **************************************************************/
-    // 1. 统计每个游程长度下非零AC系数的数量
-    int *runs_ac_num_ptr = (int *)malloc(sizeof(int) * ceiling_run);
-    if (!runs_ac_num_ptr)
+    // 反向差分编码，恢复各块的DC系数
+    for (size_t block_index = 1; block_index < ctx.block_sum; ++block_index)
     {
-        perror("Failed to allocate memory for runs_ac_num_ptr");
-        exit(EXIT_FAILURE);
+        diff_ptr[block_index] = diff_ptr[block_index] + diff_ptr[block_index - 1];
     }
-    memset(runs_ac_num_ptr, 0, sizeof(int) * ceiling_run);
 
-    for (size_t block_idx = 0; block_idx < block_sum; ++block_idx)
+    // 将加密/解密后的系数按条带写回块数组
+    for (JDIMENSION strip_row = 0; strip_row < ctx.block_height; strip_row += blocks.strip_rows)
     {
-        int zero_run_count = 0;
-        for (int zigzag_idx = 0; zigzag_idx < DCTSIZE2 - 1; ++zigzag_idx)
+        JBLOCKARRAY strip = accessStrip(blocks, strip_row, TRUE);
+        for (JDIMENSION h = strip_row; h < ctx.block_height && h < strip_row + blocks.strip_rows; ++h)
         {
-            if (ac_ptr[block_idx][zigzag_idx] != 0)
-            { // 如果是非零AC系数
-                if (zero_run_count < ceiling_run)
-                {
-                    ++runs_ac_num_ptr[zero_run_count]; // 统计该游程长度下的AC系数数量
-                }
-                zero_run_count = 0; // 重置游程计数
-            }
-            else
+            JBLOCKROW row = strip[h - strip_row];
+            size_t row_base = mcu_order ? (size_t)(h / 2) * ctx.block_width * 2 + (h % 2) * 2 : (size_t)h * ctx.block_width;
+            for (JDIMENSION w = 0; w < ctx.block_width; ++w)
             {
-                ++zero_run_count; // 零AC系数，增加游程计数
+                size_t block_index = mcu_order ? row_base + 2 * (w & ~1u) + (w & 1) : row_base + w;
+
+                // 整块写回AC系数 (通道 63 写入的DC随后被覆盖)，再写回DC系数
+                zigzagToBlock(ac_arena.block(block_index), row[w]);
+                row[w][0] = diff_ptr[block_index];
             }
         }
     }
+}
 
-    // 2. 记录非零AC系数的位置信息 (blockPosition, zigzagPosition, value)
-    nonZeroAcInfo **runs_ac_info_ptr = (nonZeroAcInfo **)malloc(sizeof(nonZeroAcInfo *) * ceiling_run);
-    if (!runs_ac_info_ptr)
+/**
+ * @brief 对各分量的DCT系数块进行加密/解密 (与系数的来源无关)
+ * 按分量填充上下文，再逐个分量 (或并行) 处理，结果写回块数组。
+ * 块数组的读写总在调用线程上进行 (libjpeg 出错时跳回调用线程设置的 setjmp)，并行时只有置乱在其他线程上进行。
+ * @param components 各分量的系数块与参数
+ * @param key 由原始图像特征生成的密钥
+ * @param is_decryption 标志，0表示加密，1表示解密
+ * @param options 方案参数 (游程上限、迭代次数、混沌模式、是否并行处理分量等)
+ * @return SCHEME_OK，或 SCHEME_OUT_OF_MEMORY (分量数据的缓冲区无法分配) / SCHEME_IMAGE_TOO_LARGE (分量的块数超过
+ *         RUN_INDEX_MAX_BLOCKS)；出错时逐个处理分量的情况下之前的分量已写回
+ */
+int transformComponents(const std::vector<componentBlocks> &components, const Key &key, int is_decryption, const SchemeContext &options)
+{
+    size_t channel = components.size(); // 图像通道数
+
+    // 为每个图像分量 (Y, Cb, Cr) 准备独立的上下文
+    std::vector<SchemeContext> contexts(channel, options);
+    for (size_t co = 0; co < channel; ++co)
     {
-        perror("Failed to allocate memory for runs_ac_info_ptr");
-        free(runs_ac_num_ptr);
-        exit(EXIT_FAILURE);
+        SchemeContext &ctx = contexts[co];
+        ctx.channel = channel;
+
+        // 由DC系数的量化步长计算DC系数的有效范围
+        int dc_step = components[co].dc_step;
+        ctx.ceiling_dc = round((double)(1016) / dc_step); // DC系数上限
+        ctx.floor_dc = round((double)(-1024) / dc_step);  // DC系数下限
+
+        ctx.block_width = components[co].width_in_blocks;   // 当前分量的块宽度
+        ctx.block_height = components[co].height_in_blocks; // 当前分量的块高度
+
+        // 针对某些特殊图像库数据进行调整 (例如，确保宽度和高度为偶数)
+        if (ctx.block_width % 2 != 0)
+            ctx.block_width--;
+        if (ctx.block_height % 2 != 0)
+            ctx.block_height--;
+
+        ctx.block_sum = ctx.block_height * ctx.block_width; // 当前分量的总块数
     }
-    for (int run_val = 0; run_val < ceiling_run; ++run_val)
+
+    // 分量数据由调用线程的工作区提供，在分量与图像之间复用
+    EncryptionWorkspace &workspace = EncryptionWorkspace::local();
+
+    if (options.parallel_components && channel > 1)
     {
-        runs_ac_info_ptr[run_val] = (nonZeroAcInfo *)malloc(sizeof(nonZeroAcInfo) * runs_ac_num_ptr[run_val]);
-        if (!runs_ac_info_ptr[run_val] && runs_ac_num_ptr[run_val] > 0)
-        { // 如果需要分配但失败
-            perror("Failed to allocate memory for runs_ac_info_ptr[run_val]");
-            for (int k = 0; k < run_val; ++k)
-                free(runs_ac_info_ptr[k]);
-            free(runs_ac_info_ptr);
-            free(runs_ac_num_ptr);
-            exit(EXIT_FAILURE);
+        // 先在调用线程上读入所有分量；各分量的置乱互不依赖，交给线程池 (置乱用到的临时数据由执行任务的线程的工作区提供，
+        // 在图像之间复用；没有线程池时在调用线程上依次置乱)，全部完成后再依次写回
+        workspace.prepareComponents(channel);
+        for (size_t co = 0; co < channel; ++co)
+        {
+            if (!workspace.components[co].prepare(contexts[co].block_sum, !options.in_place_permutation))
+                return SCHEME_OUT_OF_MEMORY;
+        }
+        for (size_t co = 0; co < channel; ++co)
+        {
+            loadComponent(contexts[co], components[co], co, workspace.components[co]);
         }
-    }
 
-    // 用于跟踪每个游程类别已找到的AC系数数量
-    int *counter_ptr = (int *)malloc(sizeof(int) * ceiling_run);
-    if (!counter_ptr)
-    {
-        perror("Failed to allocate memory for counter_ptr");
-        for (int k = 0; k < ceiling_run; ++k)
-            free(runs_ac_info_ptr[k]);
-        free(runs_ac_info_ptr);
-        free(runs_ac_num_ptr);
-        exit(EXIT_FAILURE);
-    }
-    memset(counter_ptr, 0, sizeof(int) * ceiling_run);
+        std::vector<char> scrambled(channel, 0); // 每个任务只写入自己负责的分量
+        parallelFor(options.pool, 0, channel, 1, [&](size_t begin, size_t end)
+                    {
+                        for (size_t co = begin; co < end; ++co)
+                            scrambled[co] = scrambleComponent(contexts[co], key, workspace.components[co], is_decryption);
+                    });
+        for (size_t co = 0; co < channel; ++co)
+        {
+            if (!scrambled[co])
+                return SCHEME_IMAGE_TOO_LARGE;
+        }
 
-    for (size_t block_idx = 0; block_idx < block_sum; ++block_idx)
-    {
-        int zero_run_count = 0;
-        for (int zigzag_idx = 0; zigzag_idx < DCTSIZE2 - 1; ++zigzag_idx)
+        for (size_t co = 0; co < channel; ++co)
         {
-            if (ac_ptr[block_idx][zigzag_idx] != 0)
-            {
-                if (zero_run_count < ceiling_run)
-                {
-                    int offset = counter_ptr[zero_run_count];
-                    runs_ac_info_ptr[zero_run_count][offset].blockPosition = block_idx;
-                    runs_ac_info_ptr[zero_run_count][offset].zigzagPosition = zigzag_idx;
-                    runs_ac_info_ptr[zero_run_count][offset].value = ac_ptr[block_idx][zigzag_idx];
-                    ++counter_ptr[zero_run_count];
-                }
-                zero_run_count = 0;
-            }
-            else
-            {
-                ++zero_run_count;
-            }
+            storeComponent(contexts[co], components[co], co, workspace.components[co]);
         }
     }
-
-    // 3. 生成用于ACC相同游程置乱的随机序列
-    std::vector<std::vector<randSequence>> rp3(ceiling_run);
-    for (int run_val = 0; run_val < ceiling_run; ++run_val)
+    else
     {
-        for (int ac_idx = 0; ac_idx < runs_ac_num_ptr[run_val]; ++ac_idx)
+        workspace.prepareComponents(1);
+        componentData &data = workspace.components[0];
+        for (size_t co = 0; co < channel; ++co)
         {
-            x = u * x * (1 - x); // 继续生成混沌序列
-            r.number = ac_idx;
-            r.value = x;
-            rp3[run_val].push_back(r);
+            if (!data.prepare(contexts[co].block_sum, !options.in_place_permutation))
+                return SCHEME_OUT_OF_MEMORY;
+            loadComponent(contexts[co], components[co], co, data);
+            if (!scrambleComponent(contexts[co], key, data, is_decryption))
+                return SCHEME_IMAGE_TOO_LARGE;
+            storeComponent(contexts[co], components[co], co, data);
         }
-        // 对每个游程类别的随机序列按值进行排序
-        std::sort(rp3[run_val].begin(), rp3[run_val].end(), [](const randSequence &lhs, const randSequence &rhs)
-                  { return lhs.value < rhs.value; });
     }
+    return SCHEME_OK;
+}
 
-    // 4. 执行ACC相同游程置乱
-    scrambleSameRunAcc(rp3, ac_ptr, runs_ac_info_ptr, runs_ac_num_ptr);
+/**
+ * @brief 对已读取的DCT系数进行加密/解密 (不涉及文件或内存缓冲区的读写)
+ * 生成密钥，取得各分量的系数块，再调用 transformComponents，结果写回虚拟块数组。
+ * @param cinfo 已调用 jpeg_read_coefficients 的解压缩结构体
+ * @param coeff jpeg_read_coefficients 返回的虚拟块数组
+ * @param is_decryption 标志，0表示加密，1表示解密
+ * @param options 方案参数 (游程上限、迭代次数、混沌模式、是否并行处理分量等)
+ * @return SCHEME_OK，或 transformComponents 报告的 SCHEME_OUT_OF_MEMORY / SCHEME_IMAGE_TOO_LARGE (系数可能已被部分修改)
+ */
+int transformCoefficients(struct jpeg_decompress_struct *cinfo, jvirt_barray_ptr *coeff, int is_decryption, const SchemeContext &options)
+{
+    size_t channel = cinfo->num_components; // 获取图像通道数
 
-    // 5. 释放内存
-    for (int run_val = 0; run_val < ceiling_run; ++run_val)
-    {
-        free(runs_ac_info_ptr[run_val]);
-        runs_ac_info_ptr[run_val] = NULL;
-    }
-    free(runs_ac_info_ptr);
-    runs_ac_info_ptr = NULL;
-    free(runs_ac_num_ptr);
-    runs_ac_num_ptr = NULL;
-    free(counter_ptr);
-    counter_ptr = NULL;
+    // 由已解码的系数生成密钥，图像特征在置乱前后不变，所有分量共用同一密钥
+    Key key(cinfo, coeff);
 
-    /***************************************************** scrambleMcuNoDcc ***************************************************************/
-    // 1. 生成用于MCU全局置乱的随机序列
-    std::vector<randSequence> rp4;
-    for (size_t block_idx = 0; block_idx < block_sum; ++block_idx)
+    std::vector<componentBlocks> components(channel);
+    for (size_t co = 0; co < channel; ++co)
     {
-        x = u * x * (1 - x); // 继续生成混沌序列
-        r.number = block_idx;
-        r.value = x;
-        rp4.push_back(r);
+        jpeg_component_info *comp_info = &cinfo->comp_info[co];
+        components[co].width_in_blocks = comp_info->width_in_blocks;
+        components[co].height_in_blocks = comp_info->height_in_blocks;
+        components[co].dc_step = comp_info->quant_table->quantval[0]; // DC系数的量化步长
+
+        // 虚拟块数组不一定完整驻留在内存中，按条带访问；jpeg_read_coefficients 申请数组时的 maxaccess 为 v_samp_factor 行
+        components[co].block_array = NULL;
+        components[co].virt_array = coeff[co];
+        components[co].cinfo = (j_common_ptr)cinfo;
+        components[co].strip_rows = comp_info->v_samp_factor;
     }
-    // 对随机序列按值进行排序
-    std::sort(rp4.begin(), rp4.end(), [](const randSequence &lhs, const randSequence &rhs)
-              { return lhs.value < rhs.value; });
 
-    // 2. 执行MCU全局置乱
-    scrambleMcuNoDcc(rp4, ac_ptr);
+    return transformComponents(components, key, is_decryption, options);
 }
 
 /**
- * @brief 将修改后的JPEG系数保存到文件
- * @param cinfo 指向JPEG解压缩信息结构体的指针 (用于复制参数)
- * @param coeff 指向虚拟块数组的指针 (包含修改后的系数)
- * @param img_name 输出图像的文件名
+ * @brief 对内置编解码器解码得到的系数进行加密/解密
+ * @param image 已解码的图像，结果写回其块缓冲区
+ * @param is_decryption 标志，0表示加密，1表示解密
+ * @param options 方案参数
+ * @return SCHEME_OK，或 transformComponents 报告的错误
  */
-void saveJpeg(struct jpeg_decompress_struct *cinfo, jvirt_barray_ptr *coeff, const char *img_name)
+static int transformFastImage(FastJpegImage &image, int is_decryption, const SchemeContext &options)
 {
-    struct jpeg_compress_struct cinfo_enc;
-    struct jpeg_error_mgr jerr_enc;
-    FILE *outfile = fopen(img_name, "wb");
-    if (!outfile)
+    // 密钥与 transformCoefficients 相同，由Y分量的系数生成
+    Key key(image.blockArray(0), image.widthInBlocks(0), image.heightInBlocks(0));
+
+    std::vector<componentBlocks> components(image.numComponents());
+    for (int co = 0; co < image.numComponents(); ++co)
     {
-        perror("Failed to open output JPEG file for writing");
-        exit(EXIT_FAILURE);
+        components[co].block_array = image.blockArray(co);
+        components[co].virt_array = NULL;
+        components[co].cinfo = NULL;
+        components[co].strip_rows = image.heightInBlocks(co); // 系数完整驻留在内存中，整个分量作为一个条带
+        components[co].width_in_blocks = image.widthInBlocks(co);
+        components[co].height_in_blocks = image.heightInBlocks(co);
+        components[co].dc_step = image.dcQuantStep(co);
     }
 
-    cinfo_enc.err = jpeg_std_error(&jerr_enc);
-    jpeg_create_compress(&cinfo_enc);
-    jpeg_stdio_dest(&cinfo_enc, outfile);
+    return transformComponents(components, key, is_decryption, options);
+}
 
-    // 复制原始JPEG文件的关键参数到压缩结构体，确保格式兼容性
-    j_compress_ptr cinfo_enc_ptr = &cinfo_enc;
-    jpeg_copy_critical_parameters((j_decompress_ptr)cinfo, cinfo_enc_ptr);
+/**
+ * @brief 使用内置的基线JPEG编解码器进行内存到内存的加密/解密，输出与 libjpeg 路径逐字节相同
+ * @param src 输入JPEG数据
+ * @param src_size 输入数据的字节数
+ * @param is_decryption 标志，0表示加密，1表示解密
+ * @param options 方案参数 (options.pool 同时用于并行解码各重启段)
+ * @param output 输出：加密/解密后的JPEG数据
+ * @param verify_mismatch 加密时可选 (可为 NULL)：在内存中解密并重新编码，输出与源数据第一个不同字节的偏移，完全相同时为 -1
+ * @return FAST_CODEC_UNSUPPORTED 表示输入不受支持，FAST_CODEC_ENCODE_ERROR 表示无法编码，
+ *         FAST_CODEC_OUT_OF_MEMORY 表示无法分配系数缓冲区或图像过大 (输入均未被修改，调用者应改用 libjpeg，由其报告错误)
+ */
+int fastTransformJpeg(const unsigned char *src, size_t src_size, int is_decryption, const SchemeContext &options,
+                      std::vector<unsigned char> &output, int64_t *verify_mismatch)
+{
+    FastJpegImage image;
+    if (!image.decode(src, src_size, options.pool))
+        return FAST_CODEC_UNSUPPORTED;
+
+    if (transformFastImage(image, is_decryption, options) != SCHEME_OK)
+        return FAST_CODEC_OUT_OF_MEMORY;
+
+    // 置乱前后文件大小几乎不变，以输入大小加少量余量预留空间；输出的熵编码参数只用于密文
+    output.clear();
+    output.reserve(src_size + src_size / 16);
+    bool optimize_coding = !is_decryption && options.optimize_coding;
+    unsigned int restart_interval = is_decryption ? 0 : options.restart_interval;
+    int scheme_version = is_decryption ? SCHEME_VERSION_LEGACY : schemeVersion(options);
+    unsigned char marker_payload[SCHEME_MARKER_LENGTH];
+    schemeMarkerPayload(scheme_version, marker_payload);
+    if (!image.encode(output, optimize_coding, restart_interval, scheme_version != SCHEME_VERSION_LEGACY ? marker_payload : NULL, SCHEME_MARKER_LENGTH))
+        return FAST_CODEC_ENCODE_ERROR;
+
+    if (verify_mismatch && !is_decryption)
+    {
+        std::vector<unsigned char> restored;
+        restored.reserve(src_size);
+        if (transformFastImage(image, 1, options) != SCHEME_OK) // 1表示解密
+            return FAST_CODEC_OUT_OF_MEMORY;
+        if (!image.encode(restored))
+        {
+            *verify_mismatch = 0;
+            return FAST_CODEC_DONE;
+        }
 
-    // 写入加密后的系数
-    jpeg_write_coefficients(cinfo_enc_ptr, coeff);
+        // 与 compareJpeg 相同：长度不同时，不同之处为较短数据的末尾
+        size_t length = std::min(restored.size(), src_size);
+        size_t offset = 0;
+        while (offset < length && restored[offset] == src[offset])
+            ++offset;
+        *verify_mismatch = (offset == length && restored.size() == src_size) ? -1 : (int64_t)offset;
+    }
+    return FAST_CODEC_DONE;
+}
 
-    jpeg_finish_compress(&cinfo_enc);
-    jpeg_destroy_compress(&cinfo_enc);
-    fclose(outfile);
+/**
+ * @brief 将内存中的JPEG数据写入文件
+ * @param data JPEG数据
+ * @param img_name 输出文件路径
+ * @return SCHEME_OK 或 SCHEME_WRITE_ERROR (此时删除不完整的输出文件)
+ */
+static int saveBuffer(const std::vector<unsigned char> &data, const char *img_name)
+{
+    MappedOutput output;
+    if (!output.open(img_name, data.size()))
+        return SCHEME_WRITE_ERROR;
+    memcpy(output.data(), data.data(), data.size());
+    if (!output.finish(data.size()))
+    {
+        remove(img_name);
+        return SCHEME_WRITE_ERROR;
+    }
+    return SCHEME_OK;
+}
+
+/**
+ * @brief SchemeStatus 的说明文字
+ * @param status proposedEncryptionScheme 或 selfCheckScheme 的返回值
+ * @return 说明文字 (静态字符串)
+ */
+const char *schemeStatusString(int status)
+{
+    switch (status)
+    {
+    case SCHEME_OK:
+        return "success";
+    case SCHEME_OPEN_ERROR:
+        return "failed to open the input file";
+    case SCHEME_DECODE_ERROR:
+        return "failed to decode the input JPEG";
+    case SCHEME_ENCODE_ERROR:
+        return "DCT coefficient out of range";
+    case SCHEME_WRITE_ERROR:
+        return "failed to write the output file";
+    case SCHEME_UNSUPPORTED_VERSION:
+        return "unsupported scheme version";
+    case SCHEME_VERIFY_ERROR:
+        return "decrypted coefficients could not be re-encoded";
+    case SCHEME_OUT_OF_MEMORY:
+        return "out of memory";
+    case SCHEME_IMAGE_TOO_LARGE:
+        return "image component has too many blocks";
+    default:
+        return "unknown error";
+    }
 }
 
 /**
@@ -616,221 +751,169 @@ void saveJpeg(struct jpeg_decompress_struct *cinfo, jvirt_barray_ptr *coeff, con
  * @param src_name 源图像文件路径
  * @param dst_name 目标图像文件路径
  * @param is_decryption 标志，0表示加密，1表示解密
+ * @param scheme_options 方案参数 (游程上限、迭代次数、混沌模式、是否并行处理分量等)；解密时混沌模式可被密文中的方案版本标记覆盖
+ * @param verify_mismatch 加密时可选 (可为 NULL)：写出密文后在内存中解密，并将重新编码的结果与源文件逐块比较，
+ *                        输出第一个不同字节的偏移，完全相同时为 -1；解密结果无法重新编码时返回 SCHEME_VERIFY_ERROR (密文已写出)
+ * @return SchemeStatus；出错时不终止进程 (批处理中的其余图像照常处理)
  */
-void proposedEncryptionScheme(const char *src_name, const char *dst_name, int is_decryption)
+int proposedEncryptionScheme(const char *src_name, const char *dst_name, int is_decryption, const SchemeContext &scheme_options,
+                             int64_t *verify_mismatch)
 {
     struct jpeg_decompress_struct cinfo;
-    struct jpeg_error_mgr jerr;
+    jpegJumpErrorMgr jerr;
     jvirt_barray_ptr *coeff; // 虚拟块数组指针，用于存储DCT系数
 
-    FILE *infile = fopen(src_name, "rb");
-    if (!infile)
+    MappedInput input;
+    if (!input.open(src_name))
+        return SCHEME_OPEN_ERROR;
+
+    // 解密时随机来源由密文中的方案版本标记决定，没有标记的旧密文仍按命令行指定的混沌模式解密
+    SchemeContext options = scheme_options;
+    if (is_decryption && !applySchemeVersion(input.data(), input.size(), options))
+        return SCHEME_UNSUPPORTED_VERSION;
+
+    // 内置编解码器支持的图像不经过 libjpeg，其余图像仍由 libjpeg 处理 (限制内存时总是使用 libjpeg)。
+    // 内置编码器无法编码时输入仍未被修改，同样改由 libjpeg 处理 (libjpeg 也无法编码时报告 SCHEME_ENCODE_ERROR)
+    if (options.fast_codec && !options.max_memory)
     {
-        perror("Failed to open source JPEG file for reading");
-        exit(EXIT_FAILURE);
+        std::vector<unsigned char> output;
+        if (fastTransformJpeg(input.data(), input.size(), is_decryption, options, output, verify_mismatch) == FAST_CODEC_DONE)
+            return saveBuffer(output, dst_name);
     }
 
-    cinfo.err = jpeg_std_error(&jerr);
+    cinfo.err = jpegJumpError(&jerr);
     jpeg_create_decompress(&cinfo);
-    jpeg_stdio_src(&cinfo, infile);
+    if (setjmp(jerr.setjmp_buffer))
+    {
+        jpeg_destroy_decompress(&cinfo);
+        return SCHEME_DECODE_ERROR;
+    }
+    if (options.max_memory)
+        cinfo.mem->max_memory_to_use = (long)options.max_memory; // 必须在 jpeg_read_coefficients 分配虚拟块数组之前设置
+    jpegMappedSrc(&cinfo, input);
     (void)jpeg_read_header(&cinfo, TRUE); // 读取JPEG文件头
 
-    // 读取JPEG系数
+    // 读取JPEG系数并加密/解密。限制内存时虚拟块数组按条带从后备存储换入、换出，读写失败同样跳回上面的 setjmp
+    // (块数组只在当前线程上访问，--parallel-components 的其他线程只处理已读入的数据)
     coeff = jpeg_read_coefficients(&cinfo);
-    channel = cinfo.num_components; // 获取图像通道数
-
-    // 遍历每个图像分量 (Y, Cb, Cr)
-    for (size_t co = 0; co < channel; ++co)
+    int status = transformCoefficients(&cinfo, coeff, is_decryption, options);
+    if (status != SCHEME_OK)
     {
-        jpeg_component_info *comp_info = &cinfo.comp_info[co];
-
-        // 获取量化表，用于计算DC系数的有效范围
-        JQUANT_TBL *tbl = comp_info->quant_table;
-        int dc_step = tbl->quantval[0];               // DC系数的量化步长
-        ceiling_dc = round((double)(1016) / dc_step); // DC系数上限
-        floor_dc = round((double)(-1024) / dc_step);  // DC系数下限
+        jpeg_destroy_decompress(&cinfo);
+        return status;
+    }
 
-        block_width = comp_info->width_in_blocks;   // 当前分量的块宽度
-        block_height = comp_info->height_in_blocks; // 当前分量的块高度
+    // 保存JPEG文件 (置乱前后文件大小几乎不变，以输入大小加少量余量预留空间)。
+    // 优化的 Huffman 表与重启标记只用于密文，解密结果仍按默认参数编码，与原图的编码方式一致
+    if (is_decryption)
+        status = saveJpeg(&cinfo, coeff, dst_name, input.size() + input.size() / 16);
+    else
+        status = saveJpeg(&cinfo, coeff, dst_name, input.size() + input.size() / 16, options.optimize_coding, options.restart_interval,
+                          schemeVersion(options));
+
+    // 内存中校验：系数的熵编码是无损的，内存中的密文系数与重新读取密文文件得到的系数相同。
+    // 密钥仍由密文系数重新生成 (与真正解密时一致)，这样图像特征若在置乱中被破坏也能被发现。
+    if (status == SCHEME_OK && verify_mismatch && !is_decryption)
+    {
+        status = transformCoefficients(&cinfo, coeff, 1, options); // 1表示解密
+        if (status == SCHEME_OK)
+            status = compareJpeg(&cinfo, coeff, input.data(), input.size(), verify_mismatch);
+    }
 
-        // 针对某些特殊图像库数据进行调整 (例如，确保宽度和高度为偶数)
-        if (block_width % 2 != 0)
-            block_width--;
-        if (block_height % 2 != 0)
-            block_height--;
+    // 清理JPEG解压缩结构体
+    jpeg_destroy_decompress(&cinfo);
+    return status;
+}
 
-        block_sum = block_height * block_width; // 当前分量的总块数
+/**
+ * @brief 系数级自检：加密后立即解密，与原始系数逐个比较，不进行任何JPEG编码
+ * 解密的密钥仍由密文系数重新生成 (与真正解密时一致)。
+ * @param src_name 源图像文件路径
+ * @param options 方案参数
+ * @param report 输出：比较的系数数量、不相等的数量及第一个不相等系数的位置
+ * @return SCHEME_OK，或 SCHEME_OPEN_ERROR / SCHEME_DECODE_ERROR / SCHEME_OUT_OF_MEMORY / SCHEME_IMAGE_TOO_LARGE (此时 report 无意义)
+ */
+int selfCheckScheme(const char *src_name, const SchemeContext &options, selfCheckReport *report)
+{
+    struct jpeg_decompress_struct cinfo;
+    jpegJumpErrorMgr jerr;
 
-        // 访问虚拟块数组，获取当前分量的DCT系数块
-        JBLOCKARRAY block_array = (cinfo.mem->access_virt_barray)((j_common_ptr)&cinfo, coeff[co], 0,
-                                                                  comp_info->v_samp_factor, FALSE);
+    MappedInput input;
+    if (!input.open(src_name))
+        return SCHEME_OPEN_ERROR;
 
-        // 分配内存用于存储DC差分系数和AC系数
-        JCOEF *diff_ptr = (JCOEF *)malloc(sizeof(JCOEF) * block_sum);
-        JCOEF **ac_ptr = (JCOEF **)malloc(sizeof(JCOEF *) * block_sum);
-        if (!diff_ptr || !ac_ptr)
+    cinfo.err = jpegJumpError(&jerr);
+    jpeg_create_decompress(&cinfo);
+    if (setjmp(jerr.setjmp_buffer))
+    {
+        jpeg_destroy_decompress(&cinfo);
+        return SCHEME_DECODE_ERROR;
+    }
+    if (options.max_memory)
+        cinfo.mem->max_memory_to_use = (long)options.max_memory;
+    jpegMappedSrc(&cinfo, input);
+    (void)jpeg_read_header(&cinfo, TRUE);
+    jvirt_barray_ptr *coeff = jpeg_read_coefficients(&cinfo);
+
+    // 保存所有分量的原始系数 (每次访问虚拟块数组的一个块行，依次复制)
+    size_t channel = cinfo.num_components;
+    std::vector<std::vector<JCOEF>> original(channel);
+    for (size_t co = 0; co < channel; ++co)
+    {
+        jpeg_component_info *comp_info = &cinfo.comp_info[co];
+        size_t row_length = (size_t)comp_info->width_in_blocks * DCTSIZE2;
+        original[co].resize(row_length * comp_info->height_in_blocks);
+        for (JDIMENSION h = 0; h < comp_info->height_in_blocks; ++h)
         {
-            perror("Failed to allocate memory for diff_ptr or ac_ptr");
-            exit(EXIT_FAILURE);
+            JBLOCKARRAY row = (cinfo.mem->access_virt_barray)((j_common_ptr)&cinfo, coeff[co], h, 1, FALSE);
+            memcpy(original[co].data() + h * row_length, row[0][0], sizeof(JCOEF) * row_length);
         }
+    }
 
-        // 分离DC和AC系数，并存储AC为zigzag顺序
-        JCOEF prev_dc = 0; // 用于DC差分编码的上一块DC值
-        size_t block_index = 0;
-
-        // 根据分量类型（Y或Cb/Cr）处理块的遍历方式
-        // 亮度分量 (Y) 可能会有不同的采样因子 (如4:2:0，Y分量是2x2个块对应一个Cb/Cr块)
-        // 原始代码中对co==0（通常是亮度分量）和co!=0（色度分量）有不同的处理循环，
-        // 这里是为了处理不同采样率的块顺序。
-        if (co == 0 && channel > 1)
-        { // 亮度分量，且是多通道图像
-            // 按照2x2的MCU结构遍历Y分量块
-            for (JDIMENSION h_mcu = 0; h_mcu < block_height; h_mcu += 2)
-            {
-                for (JDIMENSION w_mcu = 0; w_mcu < block_width; w_mcu += 2)
-                {
-                    // 处理 2x2 个 Y 分量块
-                    JDIMENSION h_blocks[] = {h_mcu, h_mcu, h_mcu + 1, h_mcu + 1};
-                    JDIMENSION w_blocks[] = {w_mcu, w_mcu + 1, w_mcu, w_mcu + 1};
-
-                    for (int i_block = 0; i_block < 4; ++i_block)
-                    {
-                        JCOEFPTR block_ptr = block_array[h_blocks[i_block]][w_blocks[i_block]];
-
-                        // 提取DC差分系数
-                        diff_ptr[block_index] = block_ptr[0] - prev_dc;
-                        prev_dc = block_ptr[0]; // 更新prev_dc
-
-                        // 提取AC系数并按zigzag顺序存储
-                        ac_ptr[block_index] = (JCOEF *)malloc(sizeof(JCOEF) * (DCTSIZE2 - 1));
-                        if (!ac_ptr[block_index])
-                        {
-                            perror("Failed to allocate memory for ac_ptr[block_index]");
-                            // 释放之前已分配的内存
-                            for (size_t k = 0; k < block_index; ++k)
-                                free(ac_ptr[k]);
-                            free(ac_ptr);
-                            free(diff_ptr);
-                            exit(EXIT_FAILURE);
-                        }
-                        for (int i_zigzag = 0; i_zigzag < DCTSIZE2 - 1; ++i_zigzag)
-                        {
-                            ac_ptr[block_index][i_zigzag] = block_ptr[zigzag[i_zigzag]];
-                        }
-                        ++block_index;
-                    }
-                }
-            }
-        }
-        else
-        { // 单通道图像或色度分量 (Cb/Cr)
-            for (JDIMENSION h = 0; h < block_height; ++h)
-            {
-                for (JDIMENSION w = 0; w < block_width; ++w)
-                {
-                    JCOEFPTR block_ptr = block_array[h][w];
-
-                    // 提取DC差分系数
-                    diff_ptr[block_index] = block_ptr[0] - prev_dc;
-                    prev_dc = block_ptr[0];
-
-                    // 提取AC系数并按zigzag顺序存储
-                    ac_ptr[block_index] = (JCOEF *)malloc(sizeof(JCOEF) * (DCTSIZE2 - 1));
-                    if (!ac_ptr[block_index])
-                    {
-                        perror("Failed to allocate memory for ac_ptr[block_index]");
-                        for (size_t k = 0; k < block_index; ++k)
-                            free(ac_ptr[k]);
-                        free(ac_ptr);
-                        free(diff_ptr);
-                        exit(EXIT_FAILURE);
-                    }
-                    for (int i_zigzag = 0; i_zigzag < DCTSIZE2 - 1; ++i_zigzag)
-                    {
-                        ac_ptr[block_index][i_zigzag] = block_ptr[zigzag[i_zigzag]];
-                    }
-                    ++block_index;
-                }
-            }
-        }
+    int status = transformCoefficients(&cinfo, coeff, 0, options); // 0表示加密
+    if (status == SCHEME_OK)
+        status = transformCoefficients(&cinfo, coeff, 1, options); // 1表示解密
+    if (status != SCHEME_OK)
+    {
+        jpeg_destroy_decompress(&cinfo);
+        return status;
+    }
 
-        // 调用加密或解密函数
-        if (!is_decryption)
-        {
-            encrypt(src_name, diff_ptr, ac_ptr);
-        }
-        else
+    // 逐个比较系数，记录第一个不相等系数的位置
+    report->coef_sum = 0;
+    report->mismatch_sum = 0;
+    for (size_t co = 0; co < channel; ++co)
+    {
+        jpeg_component_info *comp_info = &cinfo.comp_info[co];
+        for (JDIMENSION h = 0; h < comp_info->height_in_blocks; ++h)
         {
-            decrypt(src_name, diff_ptr, ac_ptr);
-        }
-
-        // 将加密/解密后的系数写回 block_array
-        block_index = 0;
-        prev_dc = 0; // 重置prev_dc，用于反向差分编码
-
-        if (co == 0 && channel > 1)
-        { // 亮度分量，且是多通道图像
-            for (JDIMENSION h_mcu = 0; h_mcu < block_height; h_mcu += 2)
+            const JCOEF *original_row = original[co].data() + (size_t)h * comp_info->width_in_blocks * DCTSIZE2;
+            JBLOCKROW restored_row = (cinfo.mem->access_virt_barray)((j_common_ptr)&cinfo, coeff[co], h, 1, FALSE)[0];
+            for (JDIMENSION w = 0; w < comp_info->width_in_blocks; ++w)
             {
-                for (JDIMENSION w_mcu = 0; w_mcu < block_width; w_mcu += 2)
-                {
-                    JDIMENSION h_blocks[] = {h_mcu, h_mcu, h_mcu + 1, h_mcu + 1};
-                    JDIMENSION w_blocks[] = {w_mcu, w_mcu + 1, w_mcu, w_mcu + 1};
+                const JCOEF *restored = restored_row[w];
+                const JCOEF *expected = original_row + (size_t)w * DCTSIZE2;
+                report->coef_sum += DCTSIZE2;
+                if (memcmp(restored, expected, sizeof(JCOEF) * DCTSIZE2) == 0)
+                    continue;
 
-                    for (int i_block = 0; i_block < 4; ++i_block)
-                    {
-                        JCOEFPTR block_ptr = block_array[h_blocks[i_block]][w_blocks[i_block]];
-
-                        // 写回DC系数 (反向差分编码)
-                        block_ptr[0] = diff_ptr[block_index] + prev_dc;
-                        prev_dc = block_ptr[0];
-
-                        // 写回AC系数
-                        for (int i_zigzag = 0; i_zigzag < DCTSIZE2 - 1; ++i_zigzag)
-                        {
-                            block_ptr[zigzag[i_zigzag]] = ac_ptr[block_index][i_zigzag];
-                        }
-                        ++block_index;
-                    }
-                }
-            }
-        }
-        else
-        { // 单通道图像或色度分量 (Cb/Cr)
-            for (JDIMENSION h = 0; h < block_height; ++h)
-            {
-                for (JDIMENSION w = 0; w < block_width; ++w)
+                for (int k = 0; k < DCTSIZE2; ++k)
                 {
-                    JCOEFPTR block_ptr = block_array[h][w];
-
-                    // 写回DC系数
-                    block_ptr[0] = diff_ptr[block_index] + prev_dc;
-                    prev_dc = block_ptr[0];
-
-                    // 写回AC系数
-                    for (int i_zigzag = 0; i_zigzag < DCTSIZE2 - 1; ++i_zigzag)
+                    if (restored[k] == expected[k])
+                        continue;
+                    if (report->mismatch_sum == 0)
                     {
-                        block_ptr[zigzag[i_zigzag]] = ac_ptr[block_index][i_zigzag];
+                        report->component = co;
+                        report->block_row = h;
+                        report->block_col = w;
+                        report->coef_index = k;
                     }
-                    ++block_index;
+                    ++report->mismatch_sum;
                 }
             }
         }
-
-        // 释放为当前分量分配的内存
-        free(diff_ptr);
-        diff_ptr = NULL;
-        for (size_t i = 0; i < block_sum; ++i)
-        {
-            free(ac_ptr[i]);
-            ac_ptr[i] = NULL;
-        }
-        free(ac_ptr);
-        ac_ptr = NULL;
     }
 
-    // 保存JPEG文件，并清理JPEG解压缩结构体
-    saveJpeg(&cinfo, coeff, dst_name);
     jpeg_destroy_decompress(&cinfo);
-    fclose(infile);
-}
\ No newline at end of file
+    return SCHEME_OK;
+}
@@ -0,0 +1,110 @@
+#ifndef ENCRYPTIONWORKSPACE_H
+#define ENCRYPTIONWORKSPACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h> // jpeglib.h 需要 FILE
+#include <vector>
+
+#include "jpeglib.h"          // JCOEF
+#include "coefArena.h"        // AC系数缓冲区 CoefArena
+#include "runIndex.h"         // 游程类别索引 RunClassIndex
+#include "permutationCache.h" // 置乱表 PermutationTables
+
+/**
+ * @brief 一个分量的数据：DC差分系数与AC系数块
+ * 容量只增不减，在多个分量、多张图像之间复用。
+ */
+typedef struct componentData
+{
+    std::vector<JCOEF> diff;
+    CoefArena ac_arena;
+
+    // 准备容纳 block_sum 个块 (原有内容不保留)，with_back 非0时同时准备AC系数的后台缓冲区；无法分配时返回 false
+    bool prepare(size_t block_sum, int with_back)
+    {
+        // 块数为 0 时仍保留一个元素，data() 不为空指针
+        if (diff.size() < block_sum + 1)
+            diff.resize(block_sum + 1);
+        return ac_arena.reset(block_sum) && (!with_back || ac_arena.reserveBack());
+    }
+} componentData;
+
+/**
+ * @brief 加密/解密一个分量所需的全部临时数据
+ * 所有缓冲区的容量只增不减，每个线程持有一个 (见 local())，在多个分量、多张图像之间复用，
+ * 处理过的最大分量之后，加密/解密过程本身不再分配内存。
+ * 缓冲区的内容不跨调用保留，使用前由各步骤自行填写。
+ */
+class EncryptionWorkspace
+{
+private:
+    EncryptionWorkspace(const EncryptionWorkspace &);
+    EncryptionWorkspace &operator=(const EncryptionWorkspace &);
+
+    // 容量不足时扩大到 n 个元素 (只增不减，已有元素保持不变)
+    template <typename T>
+    static void growTo(std::vector<T> &buffer, size_t n)
+    {
+        if (buffer.size() < n)
+            buffer.resize(n);
+    }
+
+public:
+    // 各分量的数据：逐个处理分量时只使用第 0 个；并行处理各分量时调用线程为每个分量使用一个，
+    // 置乱在其他线程上进行时只使用那个线程工作区中的其余临时数据
+    std::vector<componentData> components;
+
+    // DCC相同符号分组：各分组的起始位置与分组内的置乱顺序 (按起始位置连续存放，见 deriveGroupOrder())，
+    // 导出置乱顺序时的临时数组，以及置乱时暂存DCC的缓冲区
+    std::vector<uint32_t> group_offset;
+    std::vector<uint32_t> group_order;
+    std::vector<uint32_t> group_of;
+    std::vector<uint32_t> group_cursor;
+    std::vector<JCOEF> group_staging;
+
+    // DCC迭代交换：每次迭代的分组数量
+    std::vector<int> iter_group_num;
+
+    // ACC相同游程置乱：游程类别索引
+    RunClassIndex run_index;
+
+    // 不使用置乱表缓存时生成的全部置乱表
+    PermutationTables tables;
+
+    // ACC相同游程置乱时暂存所有游程类别的系数 (与游程类别索引的条目一一对应)
+    std::vector<JCOEF> run_staging;
+
+    EncryptionWorkspace() {}
+
+    /**
+     * @brief 按分量的块数与迭代次数扩大置乱用到的临时缓冲区 (不包括 components 中的分量数据)
+     * @param block_sum 分量的块数
+     * @param iter_times DCC迭代交换的迭代次数
+     */
+    void prepare(size_t block_sum, int iter_times)
+    {
+        // 分组数量最多为块数 (块数为 0 时仍写入一个空分组)
+        growTo(group_offset, block_sum + 2);
+        growTo(group_order, block_sum + 1);
+        growTo(group_of, block_sum + 1);
+        growTo(group_cursor, block_sum + 1);
+        growTo(group_staging, block_sum + 1);
+        growTo(iter_group_num, (size_t)iter_times);
+    }
+
+    // 分量数据不足 component_num 个时增加 (之前取得的分量数据的引用随之失效)
+    void prepareComponents(size_t component_num)
+    {
+        growTo(components, component_num);
+    }
+
+    // 当前线程的工作区
+    static EncryptionWorkspace &local()
+    {
+        static thread_local EncryptionWorkspace workspace;
+        return workspace;
+    }
+};
+
+#endif // ENCRYPTIONWORKSPACE_H
@@ -0,0 +1,1380 @@
+#include "fastJpeg.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "threadPool.h" // parallelFor
+#include "zigzag.h"     // zigzag_tables, blockToZigzag, nonZeroMask
+
+#define FAST_HUFF_BITS 9 // 一次查表可解码的最大码长
+#define MAX_BLOCKS_IN_MCU 10 // 与 libjpeg 的限制相同
+#define RESTART_DECODE_GRAIN 1024 // 并行解码时每个任务至少包含的 MCU 数
+
+/* 用到的JPEG标记码 */
+enum
+{
+    MARKER_SOF0 = 0xC0,
+    MARKER_SOF1 = 0xC1,
+    MARKER_DHT = 0xC4,
+    MARKER_RST0 = 0xD0,
+    MARKER_RST7 = 0xD7,
+    MARKER_SOI = 0xD8,
+    MARKER_EOI = 0xD9,
+    MARKER_SOS = 0xDA,
+    MARKER_DQT = 0xDB,
+    MARKER_DRI = 0xDD,
+    MARKER_APP0 = 0xE0,
+    MARKER_APP11 = 0xEB,
+    MARKER_APP14 = 0xEE,
+    MARKER_APP15 = 0xEF,
+    MARKER_COM = 0xFE
+};
+
+/* JPEG标准附录K中的 Huffman 表 (libjpeg 在未优化编码时使用)：bits[i] 为码长 i+1 的码字个数 */
+static const uint8_t std_dc_luminance_bits[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+static const uint8_t std_dc_luminance_values[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+static const uint8_t std_dc_chrominance_bits[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+static const uint8_t std_dc_chrominance_values[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+static const uint8_t std_ac_luminance_bits[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+static const uint8_t std_ac_luminance_values[] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa};
+
+static const uint8_t std_ac_chrominance_bits[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+static const uint8_t std_ac_chrominance_values[] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa};
+
+/* 快速AC查表项：码字与附加位都不超过 FAST_HUFF_BITS 位时，一次查表得到游程与系数值 */
+typedef struct
+{
+    int16_t value;  // 已符号扩展的系数值
+    uint8_t run;    // 系数前的 0 游程长度
+    uint8_t length; // 码字与附加位的总位数，0 表示需要逐位解码
+} fastAcEntry;
+
+/* Huffman 解码表 (与 libjpeg 的 d_derived_tbl 对应) */
+typedef struct
+{
+    bool defined;
+    uint16_t lookup[1 << FAST_HUFF_BITS]; // (码长 << 8) | 符号，0 表示码字长于 FAST_HUFF_BITS
+    fastAcEntry fast_ac[1 << FAST_HUFF_BITS];
+    int32_t maxcode[18]; // 每个码长的最大码字，-1 表示没有该长度的码字
+    int32_t valoffset[17];
+    uint8_t huffval[256];
+} huffmanDecoder;
+
+/* Huffman 编码表 (与 libjpeg 的 c_derived_tbl 对应) */
+typedef struct
+{
+    uint16_t code[256];
+    uint8_t size[256]; // 0 表示该符号没有码字
+} huffmanEncoder;
+
+/* 解码过程中的表与参数 */
+struct FastJpegImage::DecodeState
+{
+    UINT16 quantval[NUM_QUANT_TBLS][DCTSIZE2]; // 各量化表的当前内容 (自然顺序)
+    bool quant_defined[NUM_QUANT_TBLS];
+    huffmanDecoder dc_tables[NUM_HUFF_TBLS];
+    huffmanDecoder ac_tables[NUM_HUFF_TBLS];
+    unsigned int restart_interval;
+    bool saw_adobe;
+};
+
+// zigzag 顺序的第 k 个系数在自然顺序中的下标
+static inline int naturalIndex(int k)
+{
+    return k == 0 ? 0 : zigzag_tables.forward[k - 1];
+}
+
+static inline unsigned int readUint16(const unsigned char *p)
+{
+    return ((unsigned int)p[0] << 8) | p[1];
+}
+
+/**
+ * @brief 由码长分布与符号表生成解码表
+ * @param bits bits[i] 为码长 i+1 的码字个数
+ * @param huffval 按码字顺序排列的符号
+ * @param is_dc 是否为DC表 (DC符号不能超过 15)
+ * @param table 输出：解码表
+ * @return 码长分布无效时返回 false
+ */
+static bool buildHuffmanDecoder(const uint8_t *bits, const uint8_t *huffval, bool is_dc, huffmanDecoder &table)
+{
+    uint8_t huffsize[257];
+    uint32_t huffcode[257];
+
+    int num_symbols = 0;
+    for (int l = 1; l <= 16; ++l)
+    {
+        for (int i = 0; i < bits[l - 1]; ++i)
+        {
+            if (num_symbols >= 256)
+                return false;
+            huffsize[num_symbols++] = l;
+        }
+    }
+    huffsize[num_symbols] = 0;
+
+    // 生成规范 Huffman 码字，码字溢出说明码长分布无效
+    uint32_t code = 0;
+    int si = huffsize[0];
+    int p = 0;
+    while (huffsize[p])
+    {
+        while (huffsize[p] == si)
+            huffcode[p++] = code++;
+        if (code >= (1u << si))
+            return false;
+        code <<= 1;
+        ++si;
+    }
+
+    p = 0;
+    for (int l = 1; l <= 16; ++l)
+    {
+        if (bits[l - 1])
+        {
+            table.valoffset[l] = p - (int32_t)huffcode[p];
+            p += bits[l - 1];
+            table.maxcode[l] = huffcode[p - 1];
+        }
+        else
+        {
+            table.maxcode[l] = -1;
+        }
+    }
+    table.maxcode[17] = 0xFFFFF; // 哨兵
+
+    memcpy(table.huffval, huffval, num_symbols);
+    for (int i = 0; i < num_symbols; ++i)
+    {
+        if (is_dc && huffval[i] > 15)
+            return false;
+    }
+
+    memset(table.lookup, 0, sizeof(table.lookup));
+    for (p = 0; p < num_symbols; ++p)
+    {
+        int l = huffsize[p];
+        if (l > FAST_HUFF_BITS)
+            break;
+        int shift = FAST_HUFF_BITS - l;
+        for (int i = 0; i < (1 << shift); ++i)
+            table.lookup[(huffcode[p] << shift) + i] = (uint16_t)((l << 8) | huffval[p]);
+    }
+
+    // AC表：码字后紧跟的附加位也在查表宽度内时，直接存放游程与系数值
+    memset(table.fast_ac, 0, sizeof(table.fast_ac));
+    if (!is_dc)
+    {
+        for (int i = 0; i < (1 << FAST_HUFF_BITS); ++i)
+        {
+            int entry = table.lookup[i];
+            int length = entry >> 8;
+            int run = (entry >> 4) & 15;
+            int size = entry & 15;
+            if (entry == 0 || size == 0 || length + size > FAST_HUFF_BITS)
+                continue;
+            int extra = (i >> (FAST_HUFF_BITS - length - size)) & ((1 << size) - 1);
+            if (extra < (1 << (size - 1)))
+                extra -= (1 << size) - 1;
+            table.fast_ac[i].value = (int16_t)extra;
+            table.fast_ac[i].run = (uint8_t)run;
+            table.fast_ac[i].length = (uint8_t)(length + size);
+        }
+    }
+
+    table.defined = true;
+    return true;
+}
+
+/**
+ * @brief 由码长分布与符号表生成编码表
+ */
+static void buildHuffmanEncoder(const uint8_t *bits, const uint8_t *huffval, huffmanEncoder &table)
+{
+    memset(&table, 0, sizeof(table));
+    uint32_t code = 0;
+    int p = 0;
+    for (int l = 1; l <= 16; ++l)
+    {
+        for (int i = 0; i < bits[l - 1]; ++i, ++p)
+        {
+            table.code[huffval[p]] = (uint16_t)code++;
+            table.size[huffval[p]] = (uint8_t)l;
+        }
+        code <<= 1;
+    }
+}
+
+// 标准表 (表号 0 为亮度表，1 为色度表)
+static void standardTable(int tbl_no, bool is_dc, const uint8_t **bits, const uint8_t **huffval, int *num_symbols)
+{
+    if (is_dc)
+    {
+        *bits = tbl_no == 0 ? std_dc_luminance_bits : std_dc_chrominance_bits;
+        *huffval = tbl_no == 0 ? std_dc_luminance_values : std_dc_chrominance_values;
+        *num_symbols = sizeof(std_dc_luminance_values);
+    }
+    else
+    {
+        *bits = tbl_no == 0 ? std_ac_luminance_bits : std_ac_chrominance_bits;
+        *huffval = tbl_no == 0 ? std_ac_luminance_values : std_ac_chrominance_values;
+        *num_symbols = sizeof(std_ac_luminance_values);
+    }
+}
+
+/* Huffman 表的定义 (DHT 标记中的内容) */
+typedef struct
+{
+    uint8_t bits[16]; // bits[i] 为码长 i+1 的码字个数
+    uint8_t huffval[256];
+    int num_symbols;
+} huffmanSpec;
+
+static void standardSpec(int tbl_no, bool is_dc, huffmanSpec &spec)
+{
+    const uint8_t *bits, *huffval;
+    standardTable(tbl_no, is_dc, &bits, &huffval, &spec.num_symbols);
+    memcpy(spec.bits, bits, sizeof(spec.bits));
+    memcpy(spec.huffval, huffval, spec.num_symbols);
+}
+
+/**
+ * @brief 由符号频率生成优化的 Huffman 表 (与 libjpeg 的 jpeg_gen_optimal_table 逐步相同，输出的表完全一致)
+ * @param freq 各符号的频率，freq[256] 为保留的伪符号，函数会修改其内容
+ * @param spec 输出：Huffman 表
+ * @return 码长超出范围时返回 false
+ */
+static bool generateOptimalTable(long *freq, huffmanSpec &spec)
+{
+    const int max_code_length = 32;
+    uint8_t bits[max_code_length + 1] = {0};
+    int codesize[257] = {0};
+    int others[257];
+    for (int i = 0; i < 257; ++i)
+        others[i] = -1;
+
+    freq[256] = 1; // 保证没有码字全为 1
+    for (;;)
+    {
+        // 频率最小的两个符号 (频率相同时取较大的符号)
+        int c1 = -1, c2 = -1;
+        long v = 1000000000L;
+        for (int i = 0; i <= 256; ++i)
+        {
+            if (freq[i] && freq[i] <= v)
+            {
+                v = freq[i];
+                c1 = i;
+            }
+        }
+        v = 1000000000L;
+        for (int i = 0; i <= 256; ++i)
+        {
+            if (freq[i] && freq[i] <= v && i != c1)
+            {
+                v = freq[i];
+                c2 = i;
+            }
+        }
+        if (c2 < 0)
+            break;
+
+        freq[c1] += freq[c2];
+        freq[c2] = 0;
+        ++codesize[c1];
+        while (others[c1] >= 0)
+        {
+            c1 = others[c1];
+            ++codesize[c1];
+        }
+        others[c1] = c2;
+        ++codesize[c2];
+        while (others[c2] >= 0)
+        {
+            c2 = others[c2];
+            ++codesize[c2];
+        }
+    }
+
+    for (int i = 0; i <= 256; ++i)
+    {
+        if (codesize[i])
+        {
+            if (codesize[i] > max_code_length)
+                return false;
+            ++bits[codesize[i]];
+        }
+    }
+
+    // JPEG 的码长不能超过 16 位
+    int i;
+    for (i = max_code_length; i > 16; --i)
+    {
+        while (bits[i] > 0)
+        {
+            int j = i - 2;
+            while (bits[j] == 0)
+                --j;
+            bits[i] -= 2;
+            ++bits[i - 1];
+            bits[j + 1] += 2;
+            --bits[j];
+        }
+    }
+    // 去掉伪符号 256 占用的最长码字
+    while (bits[i] == 0)
+        --i;
+    --bits[i];
+
+    memcpy(spec.bits, bits + 1, sizeof(spec.bits));
+    spec.num_symbols = 0;
+    for (int length = 1; length <= max_code_length; ++length)
+    {
+        for (int symbol = 0; symbol <= 255; ++symbol)
+        {
+            if (codesize[symbol] == length)
+                spec.huffval[spec.num_symbols++] = (uint8_t)symbol;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 统计一个块的 Huffman 符号频率 (与 libjpeg 的 htest_one_block 相同)
+ * @param lanes zigzag 顺序的 64 个通道 (见 zigzag.h)，通道 63 为DC
+ * @return 系数超出基线JPEG范围时返回 false
+ */
+static bool countBlockSymbols(const JCOEF *lanes, int *last_dc, long *dc_freq, long *ac_freq)
+{
+    int temp = lanes[DCTSIZE2 - 1] - *last_dc;
+    *last_dc = lanes[DCTSIZE2 - 1];
+    int nbits = temp ? 32 - __builtin_clz((unsigned int)std::abs(temp)) : 0;
+    if (nbits > 11)
+        return false;
+    ++dc_freq[nbits];
+
+    uint64_t mask = nonZeroMask(lanes) & ~(1ULL << (DCTSIZE2 - 1));
+    int prev_lane = -1;
+    while (mask)
+    {
+        int lane = __builtin_ctzll(mask);
+        mask &= mask - 1;
+        int run = lane - prev_lane - 1;
+        prev_lane = lane;
+        for (; run > 15; run -= 16)
+            ++ac_freq[0xF0]; // ZRL
+        nbits = 32 - __builtin_clz((unsigned int)std::abs(lanes[lane]));
+        if (nbits > 10)
+            return false;
+        ++ac_freq[(run << 4) + nbits];
+    }
+    if (prev_lane < DCTSIZE2 - 2)
+        ++ac_freq[0]; // EOB
+    return true;
+}
+
+/* 熵编码数据的读取器：64 位左对齐的位缓冲区，读取时去掉 0xFF 后填充的 0x00。
+ * 数据读完后补 0 (与 libjpeg 相同)，padding_bits 记录补入的位数以便判断数据是否不足。
+ */
+typedef struct
+{
+    const unsigned char *ptr;
+    const unsigned char *end;
+    uint64_t buffer;
+    int bits;
+    int padding_bits;
+} bitReader;
+
+static inline void fillBits(bitReader &reader)
+{
+    if (reader.bits > 56)
+        return;
+
+    // 快速路径：接下来的 8 个字节中没有 0xFF 时一次装入尽可能多的整字节
+    if (reader.end - reader.ptr >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, reader.ptr, 8);
+        uint64_t inverted = ~word;
+        if (((inverted - 0x0101010101010101ULL) & ~inverted & 0x8080808080808080ULL) == 0)
+        {
+            int bytes = (64 - reader.bits) >> 3;
+            int unused = 64 - reader.bits - 8 * bytes; // 0..7，这些位留到下次装入
+            reader.buffer |= (__builtin_bswap64(word) >> reader.bits) & (~0ULL << unused);
+            reader.bits += 8 * bytes;
+            reader.ptr += bytes;
+            return;
+        }
+    }
+    while (reader.bits <= 56)
+    {
+        unsigned int byte = 0;
+        if (reader.ptr < reader.end)
+        {
+            byte = *reader.ptr++;
+            if (byte == 0xFF)
+                ++reader.ptr; // 段内的 0xFF 之后必为填充的 0x00 (见 findMarker)
+        }
+        else
+        {
+            reader.padding_bits += 8;
+        }
+        reader.buffer |= (uint64_t)byte << (56 - reader.bits);
+        reader.bits += 8;
+    }
+}
+
+static inline unsigned int peekBits(const bitReader &reader, int n)
+{
+    return (unsigned int)(reader.buffer >> (64 - n));
+}
+
+static inline void skipBits(bitReader &reader, int n)
+{
+    reader.buffer <<= n;
+    reader.bits -= n;
+}
+
+// 读取 s 位附加位并按JPEG规则扩展为有符号数
+static inline int receiveExtend(bitReader &reader, int s)
+{
+    int value = (int)peekBits(reader, s);
+    skipBits(reader, s);
+    return value < (1 << (s - 1)) ? value - (1 << s) + 1 : value;
+}
+
+static inline bool decodeSymbol(bitReader &reader, const huffmanDecoder &table, int *symbol)
+{
+    unsigned int entry = table.lookup[peekBits(reader, FAST_HUFF_BITS)];
+    if (entry)
+    {
+        skipBits(reader, entry >> 8);
+        *symbol = entry & 0xFF;
+        return true;
+    }
+
+    // 码字长于查表宽度，逐个码长比较
+    unsigned int code = peekBits(reader, 16);
+    for (int l = FAST_HUFF_BITS + 1; l <= 16; ++l)
+    {
+        int32_t c = code >> (16 - l);
+        if (c <= table.maxcode[l])
+        {
+            skipBits(reader, l);
+            *symbol = table.huffval[c + table.valoffset[l]];
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 解码一个DCT块
+ * 超出基线JPEG范围的系数 (DC差值超过 11 位，AC系数超过 10 位) 视为不支持，交给 libjpeg 处理。
+ * @return 数据有误时返回 false
+ */
+static bool decodeBlock(bitReader &reader, const huffmanDecoder &dc_table, const huffmanDecoder &ac_table, int *last_dc, JCOEF *block)
+{
+    memset(block, 0, sizeof(JCOEF) * DCTSIZE2);
+    fillBits(reader);
+
+    int s;
+    if (!decodeSymbol(reader, dc_table, &s) || s > 11)
+        return false;
+    if (s)
+        *last_dc += receiveExtend(reader, s);
+    block[0] = (JCOEF)*last_dc;
+
+    for (int k = 1; k < DCTSIZE2;)
+    {
+        if (reader.bits < 32)
+            fillBits(reader);
+
+        const fastAcEntry &entry = ac_table.fast_ac[peekBits(reader, FAST_HUFF_BITS)];
+        if (entry.length)
+        {
+            k += entry.run;
+            if (k >= DCTSIZE2)
+                return false;
+            skipBits(reader, entry.length);
+            block[naturalIndex(k++)] = entry.value;
+            continue;
+        }
+
+        int rs;
+        if (!decodeSymbol(reader, ac_table, &rs))
+            return false;
+        int r = rs >> 4;
+        s = rs & 15;
+        if (s)
+        {
+            k += r;
+            if (k >= DCTSIZE2 || s > 10)
+                return false;
+            block[naturalIndex(k++)] = (JCOEF)receiveExtend(reader, s);
+        }
+        else
+        {
+            if (r != 15)
+                break; // EOB
+            k += 16;   // ZRL
+        }
+    }
+    return true;
+}
+
+/* 一次扫描中的分量 */
+typedef struct
+{
+    JCOEF *coefficients;
+    JDIMENSION padded_width;
+    int mcu_width; // 每个 MCU 中该分量的块列数 (非交错扫描为 1)
+    int mcu_height;
+    const huffmanDecoder *dc_table;
+    const huffmanDecoder *ac_table;
+} scanComponent;
+
+typedef struct
+{
+    int comps_in_scan;
+    scanComponent comps[MAX_COMPS_IN_SCAN];
+    size_t mcus_per_row;
+} scanInfo;
+
+/**
+ * @brief 解码一个重启段 (或没有重启标记时的整个扫描)
+ * @param scan 扫描参数
+ * @param begin 段的熵编码数据起点
+ * @param end 段的终点 (下一个标记的位置)
+ * @param first_mcu 段内第一个 MCU 的序号
+ * @param last_mcu 段内最后一个 MCU 的下一个序号
+ * @return 数据有误、不足或有多余数据时返回 false
+ */
+static bool decodeSegment(const scanInfo &scan, const unsigned char *begin, const unsigned char *end, size_t first_mcu, size_t last_mcu)
+{
+    bitReader reader = {begin, end, 0, 0, 0};
+    int last_dc[MAX_COMPS_IN_SCAN] = {0}; // 每个重启段开头DC预测值归零
+
+    for (size_t mcu = first_mcu; mcu < last_mcu; ++mcu)
+    {
+        size_t mcu_row = mcu / scan.mcus_per_row;
+        size_t mcu_col = mcu % scan.mcus_per_row;
+        for (int ci = 0; ci < scan.comps_in_scan; ++ci)
+        {
+            const scanComponent &comp = scan.comps[ci];
+            for (int v = 0; v < comp.mcu_height; ++v)
+            {
+                size_t row = mcu_row * comp.mcu_height + v;
+                JCOEF *block = comp.coefficients + (row * comp.padded_width + mcu_col * comp.mcu_width) * DCTSIZE2;
+                for (int h = 0; h < comp.mcu_width; ++h, block += DCTSIZE2)
+                {
+                    if (!decodeBlock(reader, *comp.dc_table, *comp.ac_table, &last_dc[ci], block))
+                        return false;
+                }
+            }
+        }
+    }
+
+    // 用到了补入的 0 说明数据不足；剩余整字节说明有多余数据。libjpeg 对二者只给出警告，这里都交给 libjpeg
+    if (reader.padding_bits > reader.bits)
+        return false;
+    if (reader.ptr < reader.end || reader.bits - reader.padding_bits >= 8)
+        return false;
+    return true;
+}
+
+/**
+ * @brief 查找熵编码数据之后的下一个标记
+ * @param p 查找起点
+ * @param end 文件终点
+ * @param marker 输出：标记码
+ * @return 标记 (含其前的 0xFF 填充字节) 的起点；没有标记或数据不规则时返回 NULL
+ */
+static const unsigned char *findMarker(const unsigned char *p, const unsigned char *end, int *marker)
+{
+    for (;;)
+    {
+        p = (const unsigned char *)memchr(p, 0xFF, end - p);
+        if (!p || p + 1 >= end)
+            return NULL;
+        const unsigned char *q = p + 1;
+        if (*q == 0x00)
+        {
+            p = q + 1; // 填充的 0x00，属于数据
+            continue;
+        }
+        while (q < end && *q == 0xFF)
+            ++q;
+        if (q >= end || *q == 0x00)
+            return NULL; // 0xFF 0xFF 0x00 之类的不规则数据
+        *marker = *q;
+        return p;
+    }
+}
+
+FastJpegImage::FastJpegImage()
+    : m_image_width(0), m_image_height(0), m_max_h_samp_factor(1), m_max_v_samp_factor(1),
+      m_saw_jfif(false), m_jfif_major_version(1), m_jfif_minor_version(1), m_density_unit(0), m_x_density(1), m_y_density(1)
+{
+}
+
+/**
+ * @brief 解析 SOF0/SOF1 标记段并分配各分量的块缓冲区
+ */
+bool FastJpegImage::parseFrame(const unsigned char *segment, size_t length)
+{
+    if (length < 6 || segment[0] != 8)
+        return false; // 只支持 8 位精度
+    m_image_height = readUint16(segment + 1);
+    m_image_width = readUint16(segment + 3);
+    int num_components = segment[5];
+    if (m_image_height == 0 || m_image_width == 0 || length != 6 + 3 * (size_t)num_components)
+        return false; // 高度为 0 需要 DNL 标记，不支持
+    if (num_components != 1 && num_components != 3)
+        return false;
+
+    m_components.assign(num_components, Component());
+    m_max_h_samp_factor = 1;
+    m_max_v_samp_factor = 1;
+    for (int ci = 0; ci < num_components; ++ci)
+    {
+        const unsigned char *p = segment + 6 + 3 * ci;
+        Component &comp = m_components[ci];
+        comp.component_id = p[0];
+        comp.h_samp_factor = p[1] >> 4;
+        comp.v_samp_factor = p[1] & 15;
+        comp.quant_tbl_no = p[2];
+        comp.latched = false;
+        if (comp.h_samp_factor < 1 || comp.h_samp_factor > 4 || comp.v_samp_factor < 1 || comp.v_samp_factor > 4 || comp.quant_tbl_no >= NUM_QUANT_TBLS)
+            return false;
+        for (int prev = 0; prev < ci; ++prev)
+        {
+            if (m_components[prev].component_id == comp.component_id)
+                return false;
+        }
+        m_max_h_samp_factor = std::max(m_max_h_samp_factor, comp.h_samp_factor);
+        m_max_v_samp_factor = std::max(m_max_v_samp_factor, comp.v_samp_factor);
+    }
+
+    // 块数与 libjpeg 的计算相同，缓冲区按 MCU 取整
+    for (Component &comp : m_components)
+    {
+        comp.width_in_blocks = (JDIMENSION)(((long)m_image_width * comp.h_samp_factor + m_max_h_samp_factor * DCTSIZE - 1) / (m_max_h_samp_factor * DCTSIZE));
+        comp.height_in_blocks = (JDIMENSION)(((long)m_image_height * comp.v_samp_factor + m_max_v_samp_factor * DCTSIZE - 1) / (m_max_v_samp_factor * DCTSIZE));
+        comp.padded_width = (comp.width_in_blocks + comp.h_samp_factor - 1) / comp.h_samp_factor * comp.h_samp_factor;
+        comp.padded_height = (comp.height_in_blocks + comp.v_samp_factor - 1) / comp.v_samp_factor * comp.v_samp_factor;
+        comp.coefficients.assign((size_t)comp.padded_width * comp.padded_height * DCTSIZE2, 0);
+        comp.rows.resize(comp.padded_height);
+        for (JDIMENSION row = 0; row < comp.padded_height; ++row)
+            comp.rows[row] = (JBLOCKROW)&comp.coefficients[(size_t)row * comp.padded_width * DCTSIZE2];
+    }
+    return true;
+}
+
+/**
+ * @brief 解析 SOS 标记段并解码该扫描的全部熵编码数据
+ * @param state 当前的表与参数
+ * @param header SOS 标记段的内容
+ * @param length 标记段内容的字节数
+ * @param data 熵编码数据的起点
+ * @param end 文件终点
+ * @param scan_end 输出：扫描之后下一个标记的起点
+ * @param pool 并行解码各重启段使用的线程池 (可为 NULL)
+ */
+bool FastJpegImage::decodeScan(DecodeState &state, const unsigned char *header, size_t length, const unsigned char *data, const unsigned char *end,
+                               const unsigned char **scan_end, WorkStealingPool *pool)
+{
+    if (length < 1)
+        return false;
+    scanInfo scan;
+    scan.comps_in_scan = header[0];
+    if (scan.comps_in_scan < 1 || scan.comps_in_scan > MAX_COMPS_IN_SCAN || length != 4 + 2 * (size_t)scan.comps_in_scan)
+        return false;
+
+    // 只支持顺序式JPEG：Ss = 0, Se = 63, Ah = Al = 0
+    const unsigned char *spectral = header + 1 + 2 * scan.comps_in_scan;
+    if (spectral[0] != 0 || spectral[1] != DCTSIZE2 - 1 || spectral[2] != 0)
+        return false;
+
+    // 没有 JFIF 标记时，libjpeg 按分量ID 'R','G','B' 判定为 RGB 图像，此类图像交给 libjpeg
+    if (m_components.size() == 3 && !m_saw_jfif && m_components[0].component_id == 'R' && m_components[1].component_id == 'G' && m_components[2].component_id == 'B')
+        return false;
+
+    bool interleaved = scan.comps_in_scan > 1;
+    int scan_component_index[MAX_COMPS_IN_SCAN];
+    int blocks_in_mcu = 0;
+    for (int i = 0; i < scan.comps_in_scan; ++i)
+    {
+        int id = header[1 + 2 * i];
+        int dc_tbl_no = header[2 + 2 * i] >> 4;
+        int ac_tbl_no = header[2 + 2 * i] & 15;
+        int ci = 0;
+        while (ci < (int)m_components.size() && m_components[ci].component_id != id)
+            ++ci;
+        if (ci == (int)m_components.size() || dc_tbl_no >= NUM_HUFF_TBLS || ac_tbl_no >= NUM_HUFF_TBLS)
+            return false;
+        for (int prev = 0; prev < i; ++prev)
+        {
+            if (scan_component_index[prev] == ci)
+                return false;
+        }
+        scan_component_index[i] = ci;
+
+        // 与 libjpeg 相同：缺少的 0、1 号 Huffman 表使用标准表 (Motion JPEG 常省略 DHT)
+        const uint8_t *bits, *huffval;
+        int num_symbols;
+        if (!state.dc_tables[dc_tbl_no].defined)
+        {
+            if (dc_tbl_no > 1)
+                return false;
+            standardTable(dc_tbl_no, true, &bits, &huffval, &num_symbols);
+            buildHuffmanDecoder(bits, huffval, true, state.dc_tables[dc_tbl_no]);
+        }
+        if (!state.ac_tables[ac_tbl_no].defined)
+        {
+            if (ac_tbl_no > 1)
+                return false;
+            standardTable(ac_tbl_no, false, &bits, &huffval, &num_symbols);
+            buildHuffmanDecoder(bits, huffval, false, state.ac_tables[ac_tbl_no]);
+        }
+
+        // 分量第一次出现在扫描中时锁定量化表 (与 libjpeg 相同)
+        Component &comp = m_components[ci];
+        if (!comp.latched)
+        {
+            if (!state.quant_defined[comp.quant_tbl_no])
+                return false;
+            memcpy(comp.quantval, state.quantval[comp.quant_tbl_no], sizeof(comp.quantval));
+            comp.latched = true;
+        }
+
+        scanComponent &sc = scan.comps[i];
+        sc.coefficients = comp.coefficients.data();
+        sc.padded_width = comp.padded_width;
+        sc.mcu_width = interleaved ? comp.h_samp_factor : 1;
+        sc.mcu_height = interleaved ? comp.v_samp_factor : 1;
+        sc.dc_table = &state.dc_tables[dc_tbl_no];
+        sc.ac_table = &state.ac_tables[ac_tbl_no];
+        blocks_in_mcu += sc.mcu_width * sc.mcu_height;
+    }
+    if (blocks_in_mcu > MAX_BLOCKS_IN_MCU)
+        return false;
+
+    size_t mcu_rows;
+    if (interleaved)
+    {
+        scan.mcus_per_row = (m_image_width + m_max_h_samp_factor * DCTSIZE - 1) / (m_max_h_samp_factor * DCTSIZE);
+        mcu_rows = (m_image_height + m_max_v_samp_factor * DCTSIZE - 1) / (m_max_v_samp_factor * DCTSIZE);
+    }
+    else
+    {
+        const Component &comp = m_components[scan_component_index[0]];
+        scan.mcus_per_row = comp.width_in_blocks;
+        mcu_rows = comp.height_in_blocks;
+    }
+    size_t total_mcus = scan.mcus_per_row * mcu_rows;
+
+    // 先按重启标记切分熵编码数据，第 k 段必须以 RST(k mod 8) 结束，最后一段以其他标记结束
+    size_t interval = state.restart_interval ? state.restart_interval : total_mcus;
+    size_t segment_num = (total_mcus + interval - 1) / interval;
+    std::vector<const unsigned char *> segment_begin(segment_num);
+    std::vector<const unsigned char *> segment_end(segment_num);
+    const unsigned char *p = data;
+    for (size_t s = 0; s < segment_num; ++s)
+    {
+        int marker;
+        const unsigned char *marker_pos = findMarker(p, end, &marker);
+        if (!marker_pos)
+            return false;
+        bool is_last = s + 1 == segment_num;
+        bool is_restart = marker >= MARKER_RST0 && marker <= MARKER_RST7;
+        if (is_last ? is_restart : marker != MARKER_RST0 + (int)(s % 8))
+            return false;
+
+        segment_begin[s] = p;
+        segment_end[s] = marker_pos;
+        p = marker_pos;
+        if (!is_last)
+        {
+            while (*p == 0xFF)
+                ++p;
+            ++p; // 跳过 RST 标记
+        }
+    }
+    *scan_end = p;
+
+    // 各重启段的DC预测值互相独立，可以并行解码
+    std::atomic<bool> corrupt(false);
+    size_t grain = std::max((size_t)1, RESTART_DECODE_GRAIN / interval);
+    parallelFor(pool, 0, segment_num, grain, [&](size_t first, size_t last)
+                {
+                    for (size_t s = first; s < last && !corrupt.load(std::memory_order_relaxed); ++s)
+                    {
+                        size_t first_mcu = s * interval;
+                        size_t last_mcu = std::min(first_mcu + interval, total_mcus);
+                        if (!decodeSegment(scan, segment_begin[s], segment_end[s], first_mcu, last_mcu))
+                            corrupt.store(true, std::memory_order_relaxed);
+                    }
+                });
+    return !corrupt.load();
+}
+
+static bool parseQuantTables(FastJpegImage::DecodeState &state, const unsigned char *segment, size_t length)
+{
+    const unsigned char *p = segment, *end = segment + length;
+    while (p < end)
+    {
+        int precision = *p >> 4;
+        int tbl_no = *p & 15;
+        ++p;
+        size_t table_size = DCTSIZE2 * (precision ? 2 : 1);
+        if (precision > 1 || tbl_no >= NUM_QUANT_TBLS || (size_t)(end - p) < table_size)
+            return false;
+        for (int k = 0; k < DCTSIZE2; ++k)
+        {
+            state.quantval[tbl_no][naturalIndex(k)] = precision ? (UINT16)readUint16(p + 2 * k) : p[k];
+        }
+        state.quant_defined[tbl_no] = true;
+        p += table_size;
+    }
+    return true;
+}
+
+static bool parseHuffmanTables(FastJpegImage::DecodeState &state, const unsigned char *segment, size_t length)
+{
+    const unsigned char *p = segment, *end = segment + length;
+    while (p < end)
+    {
+        if (end - p < 17)
+            return false;
+        int table_class = *p >> 4;
+        int tbl_no = *p & 15;
+        if (table_class > 1 || tbl_no >= NUM_HUFF_TBLS)
+            return false;
+        const uint8_t *bits = p + 1;
+        int num_symbols = 0;
+        for (int l = 0; l < 16; ++l)
+            num_symbols += bits[l];
+        p += 17;
+        if (num_symbols > 256 || end - p < num_symbols)
+            return false;
+        huffmanDecoder &table = table_class ? state.ac_tables[tbl_no] : state.dc_tables[tbl_no];
+        if (!buildHuffmanDecoder(bits, p, table_class == 0, table))
+            return false;
+        p += num_symbols;
+    }
+    return true;
+}
+
+bool FastJpegImage::decode(const unsigned char *data, size_t size, WorkStealingPool *pool)
+{
+    m_components.clear();
+    m_saw_jfif = false;
+    m_jfif_major_version = 1;
+    m_jfif_minor_version = 1;
+    m_density_unit = 0;
+    m_x_density = 1;
+    m_y_density = 1;
+
+    std::unique_ptr<DecodeState> state(new DecodeState());
+    if (size < 4 || data[0] != 0xFF || data[1] != MARKER_SOI)
+        return false;
+
+    const unsigned char *p = data + 2, *end = data + size;
+    bool frame_seen = false;
+    bool scan_seen = false;
+    for (;;)
+    {
+        // 标记前不能有多余数据 (libjpeg 跳过并给出警告)，可以有 0xFF 填充字节
+        if (p >= end || *p != 0xFF)
+            return false;
+        while (p < end && *p == 0xFF)
+            ++p;
+        if (p >= end)
+            return false;
+        int marker = *p++;
+        if (marker == MARKER_EOI)
+            break;
+        if (end - p < 2)
+            return false;
+        size_t length = readUint16(p);
+        if (length < 2 || length > (size_t)(end - p))
+            return false;
+        const unsigned char *segment = p + 2;
+        size_t segment_length = length - 2;
+        p += length;
+
+        switch (marker)
+        {
+        case MARKER_SOF0:
+        case MARKER_SOF1:
+            if (frame_seen || !parseFrame(segment, segment_length))
+                return false;
+            frame_seen = true;
+            break;
+        case MARKER_DHT:
+            if (!parseHuffmanTables(*state, segment, segment_length))
+                return false;
+            break;
+        case MARKER_DQT:
+            if (!parseQuantTables(*state, segment, segment_length))
+                return false;
+            break;
+        case MARKER_DRI:
+            if (segment_length != 2)
+                return false;
+            state->restart_interval = readUint16(segment);
+            break;
+        case MARKER_SOS:
+            if (!frame_seen || state->saw_adobe || !decodeScan(*state, segment, segment_length, p, end, &p, pool))
+                return false;
+            scan_seen = true;
+            break;
+        case MARKER_APP0:
+            // 与 libjpeg 相同：至少 14 字节且以 "JFIF\0" 开头的 APP0 为 JFIF 标记
+            if (segment_length >= 14 && memcmp(segment, "JFIF", 5) == 0)
+            {
+                m_saw_jfif = true;
+                m_jfif_major_version = segment[5];
+                m_jfif_minor_version = segment[6];
+                m_density_unit = segment[7];
+                m_x_density = (uint16_t)readUint16(segment + 8);
+                m_y_density = (uint16_t)readUint16(segment + 10);
+            }
+            break;
+        case MARKER_APP14:
+            // Adobe 标记可能表示 RGB/CMYK 等颜色变换，交给 libjpeg
+            if (segment_length >= 12 && memcmp(segment, "Adobe", 5) == 0)
+                state->saw_adobe = true;
+            break;
+        default:
+            if ((marker > MARKER_APP0 && marker <= MARKER_APP15) || marker == MARKER_COM)
+                break;
+            return false; // 渐进式、无损、算术编码、DNL 以及未知标记
+        }
+    }
+
+    if (!scan_seen)
+        return false;
+    for (const Component &comp : m_components)
+    {
+        // libjpeg 转码时要求各分量锁定的量化表与表槽中的最终内容相同
+        if (!comp.latched || memcmp(comp.quantval, state->quantval[comp.quant_tbl_no], sizeof(comp.quantval)) != 0)
+            return false;
+    }
+    return true;
+}
+
+#define MAX_BLOCK_BYTES 1024 // 一个块的熵编码数据 (含 0x00 填充) 的上限，写出前预留
+
+/* 熵编码数据的写出器：64 位位缓冲区写满后一次写出 8 个字节，其中有 0xFF 时逐字节写出并填充 0x00。
+ * output 预先扩大，size 为已写入的字节数，结束时截断。
+ */
+typedef struct
+{
+    std::vector<unsigned char> *output;
+    size_t size;
+    uint64_t buffer;
+    int free_bits; // 位缓冲区中的空闲位数 (1..64)
+} bitWriter;
+
+// 保证至少还能写出一个块
+static inline void reserveBlock(bitWriter &writer)
+{
+    if (writer.output->size() - writer.size < MAX_BLOCK_BYTES)
+        writer.output->resize(writer.output->size() * 2 + MAX_BLOCK_BYTES);
+}
+
+static inline void putByte(bitWriter &writer, unsigned char byte)
+{
+    unsigned char *p = writer.output->data() + writer.size;
+    p[0] = byte;
+    p[1] = 0;
+    writer.size += (byte == 0xFF) ? 2 : 1;
+}
+
+static inline void putWord(bitWriter &writer, uint64_t word)
+{
+    // 没有 0xFF 字节 (即 ~word 中没有 0 字节) 时直接按大端序写出
+    uint64_t inverted = ~word;
+    if (((inverted - 0x0101010101010101ULL) & ~inverted & 0x8080808080808080ULL) == 0)
+    {
+        uint64_t big_endian = __builtin_bswap64(word);
+        memcpy(writer.output->data() + writer.size, &big_endian, 8);
+        writer.size += 8;
+        return;
+    }
+    for (int shift = 56; shift >= 0; shift -= 8)
+        putByte(writer, (unsigned char)(word >> shift));
+}
+
+// code 的高于 size 的位必须为 0
+static inline void putBits(bitWriter &writer, unsigned int code, int size)
+{
+    if (size < writer.free_bits)
+    {
+        writer.buffer = (writer.buffer << size) | code;
+        writer.free_bits -= size;
+        return;
+    }
+    int rest = size - writer.free_bits;
+    putWord(writer, (writer.buffer << writer.free_bits) | ((uint64_t)code >> rest));
+    writer.buffer = code; // 高位已写出的部分会在之后被移出
+    writer.free_bits = 64 - rest;
+}
+
+// 用 1 补足最后一个字节 (与 libjpeg 相同) 并写出位缓冲区中剩余的字节
+static inline void flushBits(bitWriter &writer)
+{
+    int pad = writer.free_bits & 7;
+    if (pad)
+        putBits(writer, (1u << pad) - 1, pad);
+    for (int bits = 64 - writer.free_bits; bits > 0; bits -= 8)
+        putByte(writer, (unsigned char)(writer.buffer >> (bits - 8)));
+    writer.free_bits = 64;
+}
+
+static inline int bitLength(unsigned int value)
+{
+    return value ? 32 - __builtin_clz(value) : 0;
+}
+
+/**
+ * @brief 编码一个DCT块 (与 libjpeg 的 encode_one_block 输出相同)
+ * @param lanes zigzag 顺序的 64 个通道 (见 zigzag.h)，通道 63 为DC
+ * @return 系数超出基线JPEG范围时返回 false
+ */
+static bool encodeBlock(bitWriter &block_writer, const huffmanEncoder &dc_table, const huffmanEncoder &ac_table, int *last_dc, const JCOEF *lanes)
+{
+    // 在局部副本上写出：输出缓冲区的字节写入可能与 block_writer 别名，局部副本的状态可以一直留在寄存器中
+    bitWriter writer = block_writer;
+    int temp = lanes[DCTSIZE2 - 1] - *last_dc;
+    *last_dc = lanes[DCTSIZE2 - 1];
+    int temp2 = temp;
+    if (temp < 0)
+    {
+        temp = -temp;
+        --temp2;
+    }
+    int nbits = bitLength(temp);
+    if (nbits > 11)
+        return false;
+    // 码字与附加位合并写出 (最多 16 + 11 位)
+    putBits(writer, ((unsigned int)dc_table.code[nbits] << nbits) | (temp2 & ((1u << nbits) - 1)), dc_table.size[nbits] + nbits);
+
+    // 只遍历非零AC系数，游程由相邻非零通道的间隔得到
+    uint64_t mask = nonZeroMask(lanes) & ~(1ULL << (DCTSIZE2 - 1));
+    int prev_lane = -1;
+    while (mask)
+    {
+        int lane = __builtin_ctzll(mask);
+        mask &= mask - 1;
+        int run = lane - prev_lane - 1;
+        prev_lane = lane;
+        while (run > 15)
+        {
+            putBits(writer, ac_table.code[0xF0], ac_table.size[0xF0]); // ZRL
+            run -= 16;
+        }
+        // 无分支地取绝对值；负数的附加位为 value - 1 的低 nbits 位
+        int value = lanes[lane];
+        int sign = value >> 31;
+        temp = (value ^ sign) - sign;
+        temp2 = value + sign;
+        nbits = 32 - __builtin_clz((unsigned int)temp);
+        if (nbits > 10)
+        {
+            block_writer = writer;
+            return false;
+        }
+        int symbol = (run << 4) + nbits;
+        putBits(writer, ((unsigned int)ac_table.code[symbol] << nbits) | (temp2 & ((1u << nbits) - 1)), ac_table.size[symbol] + nbits);
+    }
+    if (prev_lane < DCTSIZE2 - 2)
+        putBits(writer, ac_table.code[0], ac_table.size[0]); // EOB
+    block_writer = writer;
+    return true;
+}
+
+static void putMarker(std::vector<unsigned char> &output, int marker, size_t length)
+{
+    output.push_back(0xFF);
+    output.push_back((unsigned char)marker);
+    output.push_back((unsigned char)(length >> 8));
+    output.push_back((unsigned char)length);
+}
+
+static void putUint16(std::vector<unsigned char> &output, unsigned int value)
+{
+    output.push_back((unsigned char)(value >> 8));
+    output.push_back((unsigned char)value);
+}
+
+static void putHuffmanTable(std::vector<unsigned char> &output, int index, const uint8_t *bits, const uint8_t *huffval, int num_symbols)
+{
+    putMarker(output, MARKER_DHT, 2 + 1 + 16 + num_symbols);
+    output.push_back((unsigned char)index);
+    output.insert(output.end(), bits, bits + 16);
+    output.insert(output.end(), huffval, huffval + num_symbols);
+}
+
+/**
+ * @brief 按扫描顺序依次访问所有块 (与 libjpeg 的 jctrans.c 相同)
+ * 单分量图像每个 MCU 为一个块；多分量图像为单个交错扫描，图像边缘 MCU 中超出分量范围的块为虚拟块：
+ * AC 为 0，DC 等于 MCU 中同一分量前一个块的DC。
+ * @param restart_interval 重启间隔 (MCU 数)，0 表示没有重启标记
+ * @param restart 在每个重启标记的位置 (第一个 MCU 之前除外) 调用
+ * @param visit 对每个块调用 visit(分量序号, zigzag 顺序的 64 个通道)，返回 false 时停止
+ * @return visit 返回 false 时返回 false
+ */
+template <typename RestartFn, typename VisitFn>
+bool FastJpegImage::visitScanBlocks(unsigned int restart_interval, RestartFn &&restart, VisitFn &&visit) const
+{
+    int num_components = (int)m_components.size();
+    size_t mcus_per_row, mcu_rows;
+    if (num_components == 1)
+    {
+        mcus_per_row = m_components[0].width_in_blocks;
+        mcu_rows = m_components[0].height_in_blocks;
+    }
+    else
+    {
+        mcus_per_row = (m_image_width + m_max_h_samp_factor * DCTSIZE - 1) / (m_max_h_samp_factor * DCTSIZE);
+        mcu_rows = (m_image_height + m_max_v_samp_factor * DCTSIZE - 1) / (m_max_v_samp_factor * DCTSIZE);
+    }
+
+    JCOEF lanes[DCTSIZE2];
+    JCOEF dummy[DCTSIZE2] = {0};
+    JCOEF prev_dc[MAX_COMPS_IN_SCAN] = {0};
+    unsigned int restarts_to_go = restart_interval;
+    for (size_t mcu_row = 0; mcu_row < mcu_rows; ++mcu_row)
+    {
+        for (size_t mcu_col = 0; mcu_col < mcus_per_row; ++mcu_col)
+        {
+            if (restart_interval)
+            {
+                if (restarts_to_go == 0)
+                {
+                    restart();
+                    restarts_to_go = restart_interval;
+                }
+                --restarts_to_go;
+            }
+
+            for (int ci = 0; ci < num_components; ++ci)
+            {
+                const Component &comp = m_components[ci];
+                int mcu_width = num_components == 1 ? 1 : comp.h_samp_factor;
+                int mcu_height = num_components == 1 ? 1 : comp.v_samp_factor;
+                for (int v = 0; v < mcu_height; ++v)
+                {
+                    size_t row = mcu_row * mcu_height + v;
+                    for (int h = 0; h < mcu_width; ++h)
+                    {
+                        size_t col = mcu_col * mcu_width + h;
+                        const JCOEF *coef_lanes = lanes;
+                        if (row < comp.height_in_blocks && col < comp.width_in_blocks)
+                        {
+                            blockToZigzag(&comp.coefficients[(row * comp.padded_width + col) * DCTSIZE2], lanes);
+                        }
+                        else
+                        {
+                            dummy[DCTSIZE2 - 1] = prev_dc[ci];
+                            coef_lanes = dummy;
+                        }
+                        prev_dc[ci] = coef_lanes[DCTSIZE2 - 1];
+                        if (!visit(ci, coef_lanes))
+                            return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/* 标记的写出顺序与 libjpeg 的 jcmarker.c 相同：
+ * SOI, JFIF APP0, (APP11), 各分量用到的 DQT, SOF, 各分量的 DHT (先DC后AC), DRI, SOS, 熵编码数据, EOI。
+ * APP11 的位置与在 jpeg_write_coefficients 之后调用 jpeg_write_marker 写出的标记相同。
+ * 颜色空间为 YCbCr 或灰度，分量 0 使用 0 号 (亮度) Huffman 表，其余分量使用 1 号 (色度) 表。
+ */
+bool FastJpegImage::encode(std::vector<unsigned char> &output, bool optimize_coding, unsigned int restart_interval,
+                           const unsigned char *app11_payload, size_t app11_length) const
+{
+    int num_components = (int)m_components.size();
+    int table_num = std::min(num_components, 2);
+
+    // Huffman 表：标准表，或先统计一遍符号频率再生成优化的表
+    huffmanSpec dc_specs[2], ac_specs[2];
+    if (optimize_coding)
+    {
+        long dc_freq[2][257] = {{0}}, ac_freq[2][257] = {{0}};
+        int last_dc[MAX_COMPS_IN_SCAN] = {0};
+        bool counted = visitScanBlocks(
+            restart_interval, [&]()
+            { memset(last_dc, 0, sizeof(last_dc)); },
+            [&](int ci, const JCOEF *lanes)
+            {
+                int tbl_no = ci == 0 ? 0 : 1;
+                return countBlockSymbols(lanes, &last_dc[ci], dc_freq[tbl_no], ac_freq[tbl_no]);
+            });
+        if (!counted)
+            return false;
+        for (int tbl_no = 0; tbl_no < table_num; ++tbl_no)
+        {
+            if (!generateOptimalTable(dc_freq[tbl_no], dc_specs[tbl_no]) || !generateOptimalTable(ac_freq[tbl_no], ac_specs[tbl_no]))
+                return false;
+        }
+    }
+    else
+    {
+        for (int tbl_no = 0; tbl_no < table_num; ++tbl_no)
+        {
+            standardSpec(tbl_no, true, dc_specs[tbl_no]);
+            standardSpec(tbl_no, false, ac_specs[tbl_no]);
+        }
+    }
+
+    output.push_back(0xFF);
+    output.push_back(MARKER_SOI);
+
+    putMarker(output, MARKER_APP0, 16);
+    output.insert(output.end(), {'J', 'F', 'I', 'F', 0});
+    bool keep_version = m_saw_jfif && (m_jfif_major_version == 1 || m_jfif_major_version == 2);
+    output.push_back(keep_version ? m_jfif_major_version : 1);
+    output.push_back(keep_version ? m_jfif_minor_version : 1);
+    output.push_back(m_saw_jfif ? m_density_unit : 0);
+    putUint16(output, m_saw_jfif ? m_x_density : 1);
+    putUint16(output, m_saw_jfif ? m_y_density : 1);
+    output.push_back(0); // 无缩略图
+    output.push_back(0);
+
+    if (app11_payload)
+    {
+        putMarker(output, MARKER_APP11, app11_length + 2);
+        output.insert(output.end(), app11_payload, app11_payload + app11_length);
+    }
+
+    // 量化表：有大于 255 的值时使用 16 位精度，此时帧类型为 SOF1
+    bool sent_quant[NUM_QUANT_TBLS] = {false};
+    bool any_16bit = false;
+    for (const Component &comp : m_components)
+    {
+        if (sent_quant[comp.quant_tbl_no])
+            continue;
+        sent_quant[comp.quant_tbl_no] = true;
+        bool is_16bit = false;
+        for (int i = 0; i < DCTSIZE2; ++i)
+            is_16bit = is_16bit || comp.quantval[i] > 255;
+        any_16bit = any_16bit || is_16bit;
+
+        putMarker(output, MARKER_DQT, DCTSIZE2 * (is_16bit ? 2 : 1) + 1 + 2);
+        output.push_back((unsigned char)(comp.quant_tbl_no + (is_16bit ? 0x10 : 0)));
+        for (int k = 0; k < DCTSIZE2; ++k)
+        {
+            unsigned int value = comp.quantval[naturalIndex(k)];
+            if (is_16bit)
+                output.push_back((unsigned char)(value >> 8));
+            output.push_back((unsigned char)value);
+        }
+    }
+
+    putMarker(output, any_16bit ? MARKER_SOF1 : MARKER_SOF0, 3 * num_components + 2 + 5 + 1);
+    output.push_back(8);
+    putUint16(output, m_image_height);
+    putUint16(output, m_image_width);
+    output.push_back((unsigned char)num_components);
+    for (const Component &comp : m_components)
+    {
+        output.push_back((unsigned char)comp.component_id);
+        output.push_back((unsigned char)((comp.h_samp_factor << 4) + comp.v_samp_factor));
+        output.push_back((unsigned char)comp.quant_tbl_no);
+    }
+
+    huffmanEncoder dc_tables[2], ac_tables[2];
+    for (int tbl_no = 0; tbl_no < table_num; ++tbl_no)
+    {
+        buildHuffmanEncoder(dc_specs[tbl_no].bits, dc_specs[tbl_no].huffval, dc_tables[tbl_no]);
+        putHuffmanTable(output, tbl_no, dc_specs[tbl_no].bits, dc_specs[tbl_no].huffval, dc_specs[tbl_no].num_symbols);
+        buildHuffmanEncoder(ac_specs[tbl_no].bits, ac_specs[tbl_no].huffval, ac_tables[tbl_no]);
+        putHuffmanTable(output, 0x10 + tbl_no, ac_specs[tbl_no].bits, ac_specs[tbl_no].huffval, ac_specs[tbl_no].num_symbols);
+    }
+
+    if (restart_interval)
+    {
+        putMarker(output, MARKER_DRI, 4);
+        putUint16(output, restart_interval);
+    }
+
+    putMarker(output, MARKER_SOS, 2 * num_components + 2 + 1 + 3);
+    output.push_back((unsigned char)num_components);
+    for (int ci = 0; ci < num_components; ++ci)
+    {
+        output.push_back((unsigned char)m_components[ci].component_id);
+        output.push_back(ci == 0 ? 0x00 : 0x11);
+    }
+    output.push_back(0);            // Ss
+    output.push_back(DCTSIZE2 - 1); // Se
+    output.push_back(0);            // Ah/Al
+
+    bitWriter writer = {&output, output.size(), 0, 64};
+    output.resize(std::max(output.capacity(), output.size() + MAX_BLOCK_BYTES));
+    int last_dc[MAX_COMPS_IN_SCAN] = {0};
+    int next_restart_num = 0;
+    bool encoded = visitScanBlocks(
+        restart_interval, [&]()
+        {
+            // 重启标记前补齐字节，之后各分量的DC预测值归零
+            reserveBlock(writer);
+            flushBits(writer);
+            unsigned char *p = output.data() + writer.size;
+            p[0] = 0xFF;
+            p[1] = (unsigned char)(MARKER_RST0 + next_restart_num);
+            writer.size += 2;
+            next_restart_num = (next_restart_num + 1) & 7;
+            memset(last_dc, 0, sizeof(last_dc));
+        },
+        [&](int ci, const JCOEF *lanes)
+        {
+            int tbl_no = ci == 0 ? 0 : 1;
+            reserveBlock(writer);
+            return encodeBlock(writer, dc_tables[tbl_no], ac_tables[tbl_no], &last_dc[ci], lanes);
+        });
+    if (!encoded)
+        return false;
+    reserveBlock(writer);
+    flushBits(writer);
+    output.resize(writer.size);
+
+    output.push_back(0xFF);
+    output.push_back(MARKER_EOI);
+    return true;
+}
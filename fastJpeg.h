@@ -0,0 +1,113 @@
+#ifndef FASTJPEG_H
+#define FASTJPEG_H
+
+#include <stdio.h> // jpeglib.h 需要 FILE 与 size_t
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "jpeglib.h" // JBLOCKARRAY, JCOEF, DCTSIZE2
+
+class WorkStealingPool;
+
+/* 内置的基线JPEG编解码器：系数直接解码到连续的块缓冲区，不经过 libjpeg 的虚拟块数组。
+ * 解码只支持 8 位精度、Huffman 编码的顺序式JPEG (1 个或 3 个分量)，带重启标记时各重启段并行解码；
+ * 渐进式、算术编码、Adobe 颜色变换以及任何损坏或不规则的数据都返回 false，由调用者改用 libjpeg。
+ * 编码输出与 jpeg_copy_critical_parameters + jpeg_write_coefficients 的结果逐字节相同。
+ */
+class FastJpegImage
+{
+private:
+    struct Component
+    {
+        int component_id;
+        int h_samp_factor;
+        int v_samp_factor;
+        int quant_tbl_no;
+        JDIMENSION width_in_blocks;
+        JDIMENSION height_in_blocks;
+        JDIMENSION padded_width; // 按 MCU 取整后的块宽度 (与 libjpeg 的块数组相同)
+        JDIMENSION padded_height;
+        std::vector<JCOEF> coefficients; // padded_height * padded_width 个连续的块
+        std::vector<JBLOCKROW> rows;     // 指向 coefficients 中各块行
+        bool latched;                    // 是否已出现在扫描中 (此时锁定量化表)
+        UINT16 quantval[DCTSIZE2];       // 锁定的量化表 (自然顺序)
+    };
+
+    int m_image_width;
+    int m_image_height;
+    int m_max_h_samp_factor;
+    int m_max_v_samp_factor;
+    std::vector<Component> m_components;
+
+    // JFIF APP0 标记中的版本与像素密度 (libjpeg 转码时原样保留)
+    bool m_saw_jfif;
+    uint8_t m_jfif_major_version;
+    uint8_t m_jfif_minor_version;
+    uint8_t m_density_unit;
+    uint16_t m_x_density;
+    uint16_t m_y_density;
+
+public:
+    struct DecodeState; // 解码过程中的表与参数 (定义见 fastJpeg.cpp)
+
+private:
+    bool parseFrame(const unsigned char *segment, size_t length);
+    bool decodeScan(DecodeState &state, const unsigned char *header, size_t length, const unsigned char *data, const unsigned char *end,
+                    const unsigned char **scan_end, WorkStealingPool *pool);
+
+    template <typename RestartFn, typename VisitFn>
+    bool visitScanBlocks(unsigned int restart_interval, RestartFn &&restart, VisitFn &&visit) const;
+
+public:
+    FastJpegImage();
+
+    /**
+     * @brief 解码JPEG文件的全部DCT系数
+     * @param data 完整的JPEG文件
+     * @param size 文件的字节数
+     * @param pool 并行解码各重启段使用的线程池，NULL 表示串行解码
+     * @return 不支持的格式或数据有误时返回 false (此时应改用 libjpeg 处理整个文件)
+     */
+    bool decode(const unsigned char *data, size_t size, WorkStealingPool *pool);
+
+    /**
+     * @brief 将当前系数编码为基线JPEG (单个交错扫描，与 libjpeg 转码输出相同)
+     * @param output 输出缓冲区，编码结果追加在其后
+     * @param optimize_coding 为 true 时统计符号频率并使用优化的 Huffman 表，否则使用标准表
+     * @param restart_interval 每隔多少个 MCU 插入重启标记，0 表示不插入
+     * @param app11_payload 非 NULL 时在 JFIF 标记之后写出一个 APP11 标记 (例如方案版本标记)
+     * @param app11_length APP11 标记内容的字节数
+     * @return 系数超出基线JPEG的范围时返回 false
+     */
+    bool encode(std::vector<unsigned char> &output, bool optimize_coding = false, unsigned int restart_interval = 0,
+                const unsigned char *app11_payload = NULL, size_t app11_length = 0) const;
+
+    int numComponents() const
+    {
+        return (int)m_components.size();
+    }
+
+    JBLOCKARRAY blockArray(int ci)
+    {
+        return m_components[ci].rows.data();
+    }
+
+    JDIMENSION widthInBlocks(int ci) const
+    {
+        return m_components[ci].width_in_blocks;
+    }
+
+    JDIMENSION heightInBlocks(int ci) const
+    {
+        return m_components[ci].height_in_blocks;
+    }
+
+    // DC系数的量化步长
+    int dcQuantStep(int ci) const
+    {
+        return m_components[ci].quantval[0];
+    }
+};
+
+#endif // FASTJPEG_H
@@ -1,71 +1,133 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h> // memcmp
 #include <vector>
-#include <fstream>
+#include <atomic>
 #include <iostream>
+#include <algorithm>
 #include <assert.h>
 
 // 替换为更标准和跨平台的获取文件大小方式
 #include <sys/stat.h> // For stat()
 
+#include "helper.h"
+#include "jpegIo.h"     // MappedInput
+#include "threadPool.h" // parallelFor
+
+// 每次 memcmp 比较的分块大小，也是并行比较时的任务粒度
+#define COMPARE_CHUNK_SIZE (1 << 20)
+// 定位第一个不同字节时逐段比较的小段大小
+#define COMPARE_SEGMENT_SIZE 64
+// 文件不小于该大小时才并行比较
+#define PARALLEL_COMPARE_SIZE ((size_t)64 << 20)
+
 /**
  * @brief 获取文件大小 (字节)
  * @param file_name 文件路径
  * @return 文件大小，如果失败返回 -1
  */
-int fileSize(const std::string &file_name)
+int64_t fileSize(const std::string &file_name)
 {
     struct stat stat_buf;
     int rc = stat(file_name.c_str(), &stat_buf);
-    return rc == 0 ? stat_buf.st_size : -1;
+    return rc == 0 ? (int64_t)stat_buf.st_size : -1;
+}
+
+/**
+ * @brief 在长度为 length 的区间内查找第一个不同的字节
+ * 先以 memcmp (glibc 中为向量化实现) 比较 64 字节的小段，只在不同的小段内逐字节查找。
+ * @return 第一个不同字节的偏移，完全相同时返回 length
+ */
+static size_t firstMismatch(const unsigned char *data1, const unsigned char *data2, size_t length)
+{
+    size_t offset = 0;
+    while (offset + COMPARE_SEGMENT_SIZE <= length && memcmp(data1 + offset, data2 + offset, COMPARE_SEGMENT_SIZE) == 0)
+        offset += COMPARE_SEGMENT_SIZE;
+    while (offset < length && data1[offset] == data2[offset])
+        ++offset;
+    return offset;
 }
 
 /**
- * @brief 比较两个图像文件是否完全相等 (逐字节比较)
+ * @brief 比较两个图像文件是否完全相等 (内存映射后分块比较)
+ * 文件先映射到内存，以 COMPARE_CHUNK_SIZE 为单位用 memcmp 比较；
+ * 提供线程池且文件不小于 PARALLEL_COMPARE_SIZE 时，各分块并行比较。
  * @param file_name1 第一个文件路径
  * @param file_name2 第二个文件路径
+ * @param mismatch_offset 输出 (可为 NULL)：第一个不同字节的偏移，长度不同且较短文件是较长文件的前缀时为较短文件的长度；
+ *                        文件相同或无法读取时为 -1
+ * @param pool 线程池 (可为 NULL，表示串行比较)
  * @return 如果文件内容完全相同返回 true，否则返回 false
  */
-bool isImageEqual(const std::string &file_name1, const std::string &file_name2)
+bool isImageEqual(const std::string &file_name1, const std::string &file_name2, int64_t *mismatch_offset, WorkStealingPool *pool)
 {
-    int file_length1 = fileSize(file_name1);
-    int file_length2 = fileSize(file_name2);
+    if (mismatch_offset)
+        *mismatch_offset = -1;
 
-    /* 如果两个文件长度不相等，它们肯定不相等 */
-    if (file_length1 != file_length2 || file_length1 == -1)
+    int64_t file_length1 = fileSize(file_name1);
+    int64_t file_length2 = fileSize(file_name2);
+    if (file_length1 == -1 || file_length2 == -1)
     {
         return false;
     }
+    if (file_length1 == 0 || file_length2 == 0)
+    {
+        // 空文件无法映射：两个都为空时相等，否则在偏移 0 处就已不同
+        if (file_length1 != file_length2 && mismatch_offset)
+            *mismatch_offset = 0;
+        return file_length1 == file_length2;
+    }
 
-    // 使用 fstream 以二进制模式打开文件进行逐字节读取
-    std::ifstream file_read_handler1(file_name1.c_str(), std::ifstream::binary);
-    std::ifstream file_read_handler2(file_name2.c_str(), std::ifstream::binary);
-
-    if (!file_read_handler1.is_open() || !file_read_handler2.is_open())
+    MappedInput file1, file2;
+    if (!file1.open(file_name1.c_str()) || !file2.open(file_name2.c_str()))
     {
         std::cerr << "Error: Unable to open one or both files for comparison." << std::endl;
         return false;
     }
 
-    char ch1, ch2;
-    int count_bytes = 0;
-    // 逐字节读取并比较文件内容
-    while (file_read_handler1.get(ch1) && file_read_handler2.get(ch2))
+    // 即使长度不同也比较公共部分，以便报告第一个不同字节的位置
+    size_t common_length = std::min(file1.size(), file2.size());
+    size_t chunk_num = (common_length + COMPARE_CHUNK_SIZE - 1) / COMPARE_CHUNK_SIZE;
+
+    // 记录含有不同字节的最小分块序号，之后的分块不必再比较
+    std::atomic<size_t> first_bad_chunk(chunk_num);
+    auto compareChunks = [&](size_t chunk_begin, size_t chunk_end)
     {
-        if (ch1 != ch2)
+        for (size_t chunk = chunk_begin; chunk < chunk_end && chunk < first_bad_chunk.load(std::memory_order_relaxed); ++chunk)
         {
-            file_read_handler1.close();
-            file_read_handler2.close();
-            return false; // 发现不匹配的字节
+            size_t offset = chunk * COMPARE_CHUNK_SIZE;
+            size_t length = std::min((size_t)COMPARE_CHUNK_SIZE, common_length - offset);
+            if (memcmp(file1.data() + offset, file2.data() + offset, length) != 0)
+            {
+                size_t expected = first_bad_chunk.load();
+                while (chunk < expected && !first_bad_chunk.compare_exchange_weak(expected, chunk))
+                {
+                }
+                return;
+            }
         }
-        ++count_bytes;
-    }
+    };
 
-    // 确保读取的字节数与文件长度一致 (尽管文件长度已检查过)
-    assert(count_bytes == file_length1);
+    if (pool && common_length >= PARALLEL_COMPARE_SIZE)
+        parallelFor(pool, 0, chunk_num, 1, compareChunks);
+    else
+        compareChunks(0, chunk_num);
 
-    file_read_handler1.close();
-    file_read_handler2.close();
+    size_t bad_chunk = first_bad_chunk.load();
+    if (bad_chunk < chunk_num)
+    {
+        size_t offset = bad_chunk * COMPARE_CHUNK_SIZE;
+        size_t length = std::min((size_t)COMPARE_CHUNK_SIZE, common_length - offset);
+        if (mismatch_offset)
+            *mismatch_offset = offset + firstMismatch(file1.data() + offset, file2.data() + offset, length);
+        return false;
+    }
 
+    if (file1.size() != file2.size())
+    {
+        if (mismatch_offset)
+            *mismatch_offset = common_length;
+        return false;
+    }
     return true; // 所有字节都匹配
-}
\ No newline at end of file
+}
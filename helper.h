@@ -3,10 +3,13 @@
 
 #include <string>
 #include <cstdio> // for FILE*, fopen, fclose
+#include <stdint.h>
 
-// 获取文件大小
-int fileSize(const std::string &file_name);
-// 比较两个图像文件是否完全相等
-bool isImageEqual(const std::string &file_name1, const std::string &file_name2);
+class WorkStealingPool; // 工作窃取线程池，定义见 threadPool.h
+
+// 获取文件大小 (64 位，失败返回 -1)
+int64_t fileSize(const std::string &file_name);
+// 比较两个图像文件是否完全相等，可选输出第一个不同字节的偏移，并可使用线程池并行比较大文件
+bool isImageEqual(const std::string &file_name1, const std::string &file_name2, int64_t *mismatch_offset = NULL, WorkStealingPool *pool = NULL);
 
 #endif // HELPER_H
\ No newline at end of file
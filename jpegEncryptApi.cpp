@@ -0,0 +1,200 @@
+#include "jpegEncryptApi.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <atomic>
+#include <new> // std::bad_alloc
+#include <vector>
+
+#include "jpeglib.h" // JPEG库头文件
+#include "jerror.h"  // JERR_OUT_OF_MEMORY
+
+#include "encryptAndDecrypt.h" // transformCoefficients, compressCoefficients, fastTransformJpeg, applySchemeVersion
+#include "logisticMap.h"       // 混沌模式 ChaosMode
+#include "permutationCache.h"  // 置乱表缓存
+#include "jpegIo.h"            // 出错时跳回调用处的错误管理器
+
+#define JPEG_ENCRYPT_KNOWN_FLAGS (JPEG_ENCRYPT_CHAOS_FIXED128 | JPEG_ENCRYPT_PARALLEL_COMPONENTS | JPEG_ENCRYPT_IN_PLACE_PERMUTATION | JPEG_ENCRYPT_FAST_CODEC | \
+                                  JPEG_ENCRYPT_CHAOS_CHACHA20)
+
+// 进程内所有调用共用的置乱表缓存，大小为 0 时不使用 (见 setJpegPermutationCacheSize)
+static PermutationCache permutation_cache(0);
+static std::atomic<size_t> permutation_cache_size(0);
+
+// 库调用不向 stderr 输出警告信息
+static void apiOutputMessage(j_common_ptr cinfo)
+{
+    (void)cinfo;
+}
+
+/**
+ * @brief 内存到内存的加密/解密：jpeg_mem_src 读取系数，置乱后经 jpeg_mem_dest 写出
+ * @param src 输入JPEG数据
+ * @param src_size 输入数据的字节数
+ * @param dst 输出缓冲区
+ * @param dst_size 输出数据的字节数
+ * @param flags JPEG_ENCRYPT_* 标志位的组合
+ * @param is_decryption 标志，0表示加密，1表示解密
+ * @return 错误码
+ */
+static int transformJpegBuffer(const unsigned char *src, size_t src_size, unsigned char **dst, size_t *dst_size, unsigned int flags, int is_decryption)
+{
+    if (!dst || !dst_size)
+        return JPEG_ENCRYPT_INVALID_ARGUMENT;
+    *dst = NULL;
+    *dst_size = 0;
+    if (!src || src_size == 0 || (flags & ~JPEG_ENCRYPT_KNOWN_FLAGS))
+        return JPEG_ENCRYPT_INVALID_ARGUMENT;
+    if ((flags & JPEG_ENCRYPT_CHAOS_FIXED128) && (flags & JPEG_ENCRYPT_CHAOS_CHACHA20))
+        return JPEG_ENCRYPT_INVALID_ARGUMENT;
+
+    SchemeContext options;
+    options.chaos_mode = (flags & JPEG_ENCRYPT_CHAOS_FIXED128) ? CHAOS_FIXED128 : CHAOS_GMP_COMPAT;
+    if (flags & JPEG_ENCRYPT_CHAOS_CHACHA20)
+        options.chaos_mode = CHAOS_KEYSTREAM;
+    options.parallel_components = (flags & JPEG_ENCRYPT_PARALLEL_COMPONENTS) ? 1 : 0;
+    options.in_place_permutation = (flags & JPEG_ENCRYPT_IN_PLACE_PERMUTATION) ? 1 : 0;
+    if (permutation_cache_size.load())
+        options.permutation_cache = &permutation_cache;
+
+    // 带有方案版本标记的密文按标记选择随机来源
+    if (is_decryption && !applySchemeVersion(src, src_size, options))
+        return JPEG_ENCRYPT_UNSUPPORTED_SCHEME;
+
+    // 内置编解码器不支持或无法编码的输入仍由下面的 libjpeg 路径处理 (src 未被修改)。
+    // 库接口不能让异常穿过 C 调用者，std::vector 等分配失败时返回 JPEG_ENCRYPT_OUT_OF_MEMORY
+    if (flags & JPEG_ENCRYPT_FAST_CODEC)
+    {
+        std::vector<unsigned char> output;
+        int fast_result;
+        try
+        {
+            fast_result = fastTransformJpeg(src, src_size, is_decryption, options, output);
+        }
+        catch (const std::bad_alloc &)
+        {
+            return JPEG_ENCRYPT_OUT_OF_MEMORY;
+        }
+        if (fast_result == FAST_CODEC_DONE)
+        {
+            unsigned char *buffer = (unsigned char *)malloc(output.size());
+            if (!buffer)
+                return JPEG_ENCRYPT_OUT_OF_MEMORY;
+            memcpy(buffer, output.data(), output.size());
+            *dst = buffer;
+            *dst_size = output.size();
+            return JPEG_ENCRYPT_OK;
+        }
+    }
+
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_compress_struct cinfo_enc;
+    jpegJumpErrorMgr jerr; // 解压缩与压缩结构体共用同一个错误管理器 (同一线程内依次使用)
+    unsigned char *out_buffer = NULL; // 由 jpeg_mem_dest 分配
+    unsigned long out_size = 0;
+    volatile int failure_status = JPEG_ENCRYPT_DECODE_ERROR; // 出错时返回的错误码，随处理阶段更新
+
+    cinfo.err = jpegJumpError(&jerr);
+    cinfo_enc.err = &jerr.pub;
+    jerr.pub.output_message = apiOutputMessage;
+    jpeg_create_decompress(&cinfo);
+    jpeg_create_compress(&cinfo_enc);
+
+    if (setjmp(jerr.setjmp_buffer))
+    {
+        // jpeg_mem_dest 扩容后的缓冲区只在 term_destination 中写回 out_buffer，先写回再释放
+        if (cinfo_enc.dest)
+            cinfo_enc.dest->term_destination(&cinfo_enc);
+        free(out_buffer);
+        jpeg_destroy_compress(&cinfo_enc);
+        jpeg_destroy_decompress(&cinfo);
+        return jerr.pub.msg_code == JERR_OUT_OF_MEMORY ? JPEG_ENCRYPT_OUT_OF_MEMORY : (int)failure_status;
+    }
+
+    jpeg_mem_src(&cinfo, src, (unsigned long)src_size);
+    (void)jpeg_read_header(&cinfo, TRUE);
+    jvirt_barray_ptr *coeff = jpeg_read_coefficients(&cinfo);
+
+    // 截断或损坏的数据在 libjpeg 中只产生警告 (缺失的部分以零填充)，库调用不输出警告，因此按解码失败返回
+    if (jerr.pub.num_warnings != 0)
+    {
+        jpeg_destroy_compress(&cinfo_enc);
+        jpeg_destroy_decompress(&cinfo);
+        return JPEG_ENCRYPT_DECODE_ERROR;
+    }
+
+    // 块数组只在当前线程上访问 (并行处理分量时其他线程只处理已读入的数据)，出错时仍跳回上面的 setjmp；
+    // 系数缓冲区或其他临时数据无法分配时清理两个结构体后返回
+    int scheme_status;
+    try
+    {
+        scheme_status = transformCoefficients(&cinfo, coeff, is_decryption, options);
+    }
+    catch (const std::bad_alloc &)
+    {
+        scheme_status = SCHEME_OUT_OF_MEMORY;
+    }
+    if (scheme_status != SCHEME_OK)
+    {
+        jpeg_destroy_compress(&cinfo_enc);
+        jpeg_destroy_decompress(&cinfo);
+        return scheme_status == SCHEME_IMAGE_TOO_LARGE ? JPEG_ENCRYPT_IMAGE_TOO_LARGE : JPEG_ENCRYPT_OUT_OF_MEMORY;
+    }
+
+    failure_status = JPEG_ENCRYPT_ENCODE_ERROR;
+    jpeg_mem_dest(&cinfo_enc, &out_buffer, &out_size);
+    compressCoefficients(&cinfo, coeff, &cinfo_enc, 0, 0, is_decryption ? SCHEME_VERSION_LEGACY : schemeVersion(options));
+
+    jpeg_destroy_compress(&cinfo_enc);
+    jpeg_destroy_decompress(&cinfo);
+
+    *dst = out_buffer;
+    *dst_size = out_size;
+    return JPEG_ENCRYPT_OK;
+}
+
+int encryptJpegBuffer(const unsigned char *src, size_t src_size, unsigned char **dst, size_t *dst_size, unsigned int flags)
+{
+    return transformJpegBuffer(src, src_size, dst, dst_size, flags, 0); // 0表示加密
+}
+
+int decryptJpegBuffer(const unsigned char *src, size_t src_size, unsigned char **dst, size_t *dst_size, unsigned int flags)
+{
+    return transformJpegBuffer(src, src_size, dst, dst_size, flags, 1); // 1表示解密
+}
+
+void setJpegPermutationCacheSize(size_t bytes)
+{
+    permutation_cache.setCapacity(bytes);
+    permutation_cache_size.store(bytes);
+}
+
+void freeJpegBuffer(unsigned char *buffer)
+{
+    free(buffer); // jpeg_mem_dest 使用 malloc 分配输出缓冲区
+}
+
+const char *jpegEncryptStatusString(int status)
+{
+    switch (status)
+    {
+    case JPEG_ENCRYPT_OK:
+        return "success";
+    case JPEG_ENCRYPT_INVALID_ARGUMENT:
+        return "invalid argument";
+    case JPEG_ENCRYPT_DECODE_ERROR:
+        return "failed to decode the input JPEG";
+    case JPEG_ENCRYPT_ENCODE_ERROR:
+        return "failed to encode the output JPEG";
+    case JPEG_ENCRYPT_UNSUPPORTED_SCHEME:
+        return "unsupported scheme version";
+    case JPEG_ENCRYPT_OUT_OF_MEMORY:
+        return "out of memory";
+    case JPEG_ENCRYPT_IMAGE_TOO_LARGE:
+        return "image component has too many blocks";
+    default:
+        return "unknown error";
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef JPEGENCRYPTAPI_H
+#define JPEGENCRYPTAPI_H
+
+/* 内存到内存的JPEG加密/解密接口 (C ABI)：
+ * 输入与输出都是内存中的完整JPEG文件，不读写磁盘，出错时返回错误码而不是终止进程。
+ * 本头文件只使用 C 语言类型，可以直接被 C 程序或其他语言的 FFI 引用；
+ * 编译为共享库的方法见 README.md。
+ */
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#define JPEG_ENCRYPT_API __declspec(dllexport)
+#elif defined(__GNUC__)
+#define JPEG_ENCRYPT_API __attribute__((visibility("default")))
+#else
+#define JPEG_ENCRYPT_API
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* 返回值 (错误码) */
+#define JPEG_ENCRYPT_OK 0                 // 成功
+#define JPEG_ENCRYPT_INVALID_ARGUMENT 1   // 参数无效 (空指针、长度为 0 或未知的标志位)
+#define JPEG_ENCRYPT_DECODE_ERROR 2       // 输入不是可读取的JPEG数据 (包括截断或损坏的数据)
+#define JPEG_ENCRYPT_ENCODE_ERROR 3       // 写出JPEG数据失败
+#define JPEG_ENCRYPT_UNSUPPORTED_SCHEME 4 // 密文的方案版本标记不受支持 (由更新版本的程序加密)
+#define JPEG_ENCRYPT_OUT_OF_MEMORY 5      // 内存不足
+#define JPEG_ENCRYPT_IMAGE_TOO_LARGE 6    // 图像分量的块数超过上限 (2^26 个块)
+
+/* 标志位，可按位或组合；0 表示默认参数 (与命令行默认行为相同) */
+#define JPEG_ENCRYPT_CHAOS_FIXED128 0x1        // 使用 128 位定点数混沌序列 (对应 --chaos fixed128)
+#define JPEG_ENCRYPT_PARALLEL_COMPONENTS 0x2   // 并行处理图像的各个分量 (对应 --parallel-components；库接口没有线程池，目前依次处理)
+#define JPEG_ENCRYPT_IN_PLACE_PERMUTATION 0x4  // 原地进行MCU与DCC分组置乱 (对应 --in-place)
+#define JPEG_ENCRYPT_FAST_CODEC 0x8            // 优先使用内置的基线JPEG编解码器 (对应 --fast-codec)
+#define JPEG_ENCRYPT_CHAOS_CHACHA20 0x10       // 使用 ChaCha20 密钥流生成置乱表 (对应 --chaos chacha20)，不能与 CHAOS_FIXED128 同时使用
+
+/**
+ * @brief 加密内存中的JPEG图像
+ * @param src 输入JPEG数据
+ * @param src_size 输入数据的字节数
+ * @param dst 输出：加密后的JPEG数据，成功时由调用者使用 freeJpegBuffer 释放，失败时置为 NULL
+ * @param dst_size 输出：加密后数据的字节数
+ * @param flags JPEG_ENCRYPT_* 标志位的组合
+ * @return JPEG_ENCRYPT_OK 表示成功，否则为错误码
+ */
+JPEG_ENCRYPT_API int encryptJpegBuffer(const unsigned char *src, size_t src_size, unsigned char **dst, size_t *dst_size, unsigned int flags);
+
+/**
+ * @brief 解密内存中由 encryptJpegBuffer (或命令行工具) 加密的JPEG图像
+ * @param src 输入JPEG数据
+ * @param src_size 输入数据的字节数
+ * @param dst 输出：解密后的JPEG数据，成功时由调用者使用 freeJpegBuffer 释放，失败时置为 NULL
+ * @param dst_size 输出：解密后数据的字节数
+ * @param flags JPEG_ENCRYPT_* 标志位的组合；带有方案版本标记的密文自动选择随机来源，
+ *              没有标记的密文须与加密时使用的混沌模式一致
+ * @return JPEG_ENCRYPT_OK 表示成功，否则为错误码
+ */
+JPEG_ENCRYPT_API int decryptJpegBuffer(const unsigned char *src, size_t src_size, unsigned char **dst, size_t *dst_size, unsigned int flags);
+
+/**
+ * @brief 释放 encryptJpegBuffer / decryptJpegBuffer 返回的缓冲区
+ * @param buffer 输出缓冲区 (可为 NULL)
+ */
+JPEG_ENCRYPT_API void freeJpegBuffer(unsigned char *buffer);
+
+/**
+ * @brief 设置置乱表缓存的大小 (进程内所有调用共用)
+ * 同一幅图像被重复加密/解密时 (例如反复解密同一批密文)，缓存中的置乱表可以跳过混沌序列的生成与排序。
+ * 默认不缓存；可以在任意时刻调用，缩小时立即淘汰超出的部分。
+ * @param bytes 缓存的置乱表占用的字节数上限，0 表示不缓存
+ */
+JPEG_ENCRYPT_API void setJpegPermutationCacheSize(size_t bytes);
+
+/**
+ * @brief 获取错误码对应的说明文字
+ * @param status 错误码
+ * @return 静态字符串，调用者无需释放
+ */
+JPEG_ENCRYPT_API const char *jpegEncryptStatusString(int status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JPEGENCRYPTAPI_H
@@ -0,0 +1,398 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "jpegIo.h"
+#include "jerror.h" // WARNMS, ERREXIT
+
+// 退化为堆缓冲区时的对齐方式 (同时也是容量的取整单位)
+#define OUTPUT_ALIGNMENT 4096
+
+// 比较目标管理器每次比较的字节数
+#define COMPARE_BUFFER_SIZE 65536
+
+/*************************************************** MappedInput ***************************************************/
+
+MappedInput::~MappedInput()
+{
+    if (m_data)
+        munmap((void *)m_data, m_size);
+}
+
+/**
+ * @brief 映射整个文件
+ * @param file_name 文件路径
+ * @return 失败时返回 false 并保留 errno
+ */
+bool MappedInput::open(const char *file_name)
+{
+    int fd = ::open(file_name, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0)
+    {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return false;
+    }
+
+    // 长度为 0 的文件无法映射，也不是合法的JPEG
+    if (file_stat.st_size == 0)
+    {
+        close(fd);
+        errno = EINVAL;
+        return false;
+    }
+
+    void *data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int saved_errno = errno;
+    close(fd); // 映射建立后即可关闭文件描述符
+    if (data == MAP_FAILED)
+    {
+        errno = saved_errno;
+        return false;
+    }
+
+    // libjpeg 从头到尾顺序读取
+    madvise(data, file_stat.st_size, MADV_SEQUENTIAL);
+
+    m_data = (const unsigned char *)data;
+    m_size = file_stat.st_size;
+    return true;
+}
+
+/*************************************************** MappedOutput ***************************************************/
+
+MappedOutput::~MappedOutput()
+{
+    // 未调用 finish() (例如出错) 时只释放资源，文件内容不做保证
+    if (m_mapped && m_data)
+        munmap(m_data, m_capacity);
+    else if (!m_mapped)
+        free(m_data);
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+/**
+ * @brief 创建 (或截断) 输出文件并预留空间
+ * @param file_name 文件路径
+ * @param size_hint 预估的输出大小，不足时自动扩大
+ * @return 失败时返回 false 并保留 errno
+ */
+bool MappedOutput::open(const char *file_name, size_t size_hint)
+{
+    m_fd = ::open(file_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0)
+        return false;
+    if (size_hint < OUTPUT_ALIGNMENT)
+        size_hint = OUTPUT_ALIGNMENT;
+
+    // 先尝试映射文件，普通文件之外 (例如设备或管道) 退化为堆缓冲区
+    struct stat file_stat;
+    m_mapped = fstat(m_fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode);
+    if (reserve(size_hint))
+        return true;
+    if (!m_mapped)
+        return false;
+
+    m_mapped = false;
+    return reserve(size_hint);
+}
+
+/**
+ * @brief 将容量扩大到至少 capacity，已写入的数据保持不变
+ * @return 失败时返回 false 并保留 errno
+ */
+bool MappedOutput::reserve(size_t capacity)
+{
+    capacity = (capacity + OUTPUT_ALIGNMENT - 1) / OUTPUT_ALIGNMENT * OUTPUT_ALIGNMENT;
+    if (capacity <= m_capacity)
+        return true;
+
+    if (m_mapped)
+    {
+        // 预先分配磁盘块，写入映射区时不再触发分配；文件系统不支持时退回 ftruncate
+        if (fallocate(m_fd, 0, 0, capacity) != 0 && ftruncate(m_fd, capacity) != 0)
+            return false;
+
+        void *data = m_data ? mremap(m_data, m_capacity, capacity, MREMAP_MAYMOVE)
+                            : mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if (data == MAP_FAILED)
+            return false;
+        m_data = (unsigned char *)data;
+    }
+    else
+    {
+        unsigned char *data = (unsigned char *)aligned_alloc(OUTPUT_ALIGNMENT, capacity);
+        if (!data)
+            return false;
+        if (m_data)
+            memcpy(data, m_data, m_capacity);
+        free(m_data);
+        m_data = data;
+    }
+    m_capacity = capacity;
+    return true;
+}
+
+/**
+ * @brief 以实际长度结束输出：截断文件 (或写出缓冲区) 并关闭
+ * @param size 实际写入的字节数
+ * @return 失败时返回 false 并保留 errno
+ */
+bool MappedOutput::finish(size_t size)
+{
+    bool ok = true;
+    if (m_mapped)
+    {
+        ok = munmap(m_data, m_capacity) == 0 && ftruncate(m_fd, size) == 0;
+    }
+    else
+    {
+        for (size_t written = 0; ok && written < size;)
+        {
+            ssize_t result = write(m_fd, m_data + written, size - written);
+            if (result < 0 && errno != EINTR)
+                ok = false;
+            else if (result > 0)
+                written += result;
+        }
+        free(m_data);
+    }
+    m_data = NULL;
+    m_capacity = 0;
+
+    if (close(m_fd) != 0)
+        ok = false;
+    m_fd = -1;
+    return ok;
+}
+
+/*************************************************** 错误管理器 ***************************************************/
+
+static void jumpErrorExit(j_common_ptr cinfo)
+{
+    jpegJumpErrorMgr *err = (jpegJumpErrorMgr *)cinfo->err;
+    longjmp(err->setjmp_buffer, 1);
+}
+
+/**
+ * @brief 初始化错误管理器：警告仍按 jpeg_std_error 的方式输出，出错时跳回 setjmp_buffer 而不是终止进程
+ * @param err 错误管理器，须在解压缩/压缩结构体销毁前保持有效
+ * @return &err->pub，可直接赋给 cinfo.err
+ */
+struct jpeg_error_mgr *jpegJumpError(jpegJumpErrorMgr *err)
+{
+    jpeg_std_error(&err->pub);
+    err->pub.error_exit = jumpErrorExit;
+    return &err->pub;
+}
+
+/*************************************************** 数据源管理器 ***************************************************/
+
+static void initMappedSource(j_decompress_ptr cinfo)
+{
+    (void)cinfo; // 整个映射区在 jpegMappedSrc 中一次性交给 libjpeg
+}
+
+static boolean fillMappedInputBuffer(j_decompress_ptr cinfo)
+{
+    // 映射区已全部读完仍请求数据，说明文件被截断：与 libjpeg 的做法相同，插入伪造的 EOI 标记
+    static const JOCTET fake_eoi[2] = {0xFF, JPEG_EOI};
+    WARNMS(cinfo, JWRN_JPEG_EOF);
+
+    cinfo->src->next_input_byte = fake_eoi;
+    cinfo->src->bytes_in_buffer = 2;
+    return TRUE;
+}
+
+static void skipMappedInputData(j_decompress_ptr cinfo, long num_bytes)
+{
+    struct jpeg_source_mgr *src = cinfo->src;
+    if (num_bytes <= 0)
+        return;
+
+    while (num_bytes > (long)src->bytes_in_buffer)
+    {
+        num_bytes -= (long)src->bytes_in_buffer;
+        (void)fillMappedInputBuffer(cinfo);
+    }
+    src->next_input_byte += num_bytes;
+    src->bytes_in_buffer -= num_bytes;
+}
+
+static void termMappedSource(j_decompress_ptr cinfo)
+{
+    (void)cinfo; // 映射由 MappedInput 负责解除
+}
+
+/**
+ * @brief 从内存映射的输入文件读取JPEG数据 (替代 jpeg_stdio_src)
+ * @param cinfo 解压缩结构体
+ * @param input 已映射的输入文件，须在解压缩结束前保持有效
+ */
+void jpegMappedSrc(j_decompress_ptr cinfo, const MappedInput &input)
+{
+    if (cinfo->src == NULL)
+    {
+        cinfo->src = (struct jpeg_source_mgr *)(*cinfo->mem->alloc_small)((j_common_ptr)cinfo, JPOOL_PERMANENT,
+                                                                          sizeof(struct jpeg_source_mgr));
+    }
+
+    struct jpeg_source_mgr *src = cinfo->src;
+    src->init_source = initMappedSource;
+    src->fill_input_buffer = fillMappedInputBuffer;
+    src->skip_input_data = skipMappedInputData;
+    src->resync_to_restart = jpeg_resync_to_restart; // 使用默认方法
+    src->term_source = termMappedSource;
+    src->next_input_byte = input.data();
+    src->bytes_in_buffer = input.size();
+}
+
+/*************************************************** 数据目标管理器 ***************************************************/
+
+typedef struct
+{
+    struct jpeg_destination_mgr pub;
+    MappedOutput *output;
+} mappedDestinationMgr;
+
+static void initMappedDestination(j_compress_ptr cinfo)
+{
+    mappedDestinationMgr *dest = (mappedDestinationMgr *)cinfo->dest;
+    dest->pub.next_output_byte = dest->output->data();
+    dest->pub.free_in_buffer = dest->output->capacity();
+}
+
+static boolean emptyMappedOutputBuffer(j_compress_ptr cinfo)
+{
+    // 预估大小不足：容量翻倍 (映射区地址可能变化)，已写入的数据保持不变
+    mappedDestinationMgr *dest = (mappedDestinationMgr *)cinfo->dest;
+    size_t used = dest->output->capacity();
+    if (!dest->output->reserve(2 * used))
+        ERREXIT(cinfo, JERR_FILE_WRITE);
+
+    dest->pub.next_output_byte = dest->output->data() + used;
+    dest->pub.free_in_buffer = dest->output->capacity() - used;
+    return TRUE;
+}
+
+static void termMappedDestination(j_compress_ptr cinfo)
+{
+    mappedDestinationMgr *dest = (mappedDestinationMgr *)cinfo->dest;
+    if (!dest->output->finish(dest->output->capacity() - dest->pub.free_in_buffer))
+        ERREXIT(cinfo, JERR_FILE_WRITE);
+}
+
+/**
+ * @brief 将JPEG数据写入预分配的输出文件 (替代 jpeg_stdio_dest)，压缩结束时自动调用 output.finish()
+ * @param cinfo 压缩结构体
+ * @param output 已打开的输出文件，须在压缩结束前保持有效
+ */
+void jpegMappedDest(j_compress_ptr cinfo, MappedOutput &output)
+{
+    if (cinfo->dest == NULL)
+    {
+        cinfo->dest = (struct jpeg_destination_mgr *)(*cinfo->mem->alloc_small)((j_common_ptr)cinfo, JPOOL_PERMANENT,
+                                                                                sizeof(mappedDestinationMgr));
+    }
+
+    mappedDestinationMgr *dest = (mappedDestinationMgr *)cinfo->dest;
+    dest->pub.init_destination = initMappedDestination;
+    dest->pub.empty_output_buffer = emptyMappedOutputBuffer;
+    dest->pub.term_destination = termMappedDestination;
+    dest->output = &output;
+}
+
+/*************************************************** 比较目标管理器 ***************************************************/
+
+typedef struct
+{
+    struct jpeg_destination_mgr pub;
+    compareTarget *target;
+    JOCTET *buffer;
+    size_t compared; // 已比较的字节数
+} compareDestinationMgr;
+
+/**
+ * @brief 将新输出的 size 个字节与参考数据比较，发现不同时记录偏移并提前结束压缩
+ */
+static void compareOutputBytes(compareDestinationMgr *dest, size_t size)
+{
+    compareTarget *target = dest->target;
+    const unsigned char *reference = target->reference + dest->compared;
+    size_t available = target->reference_size - dest->compared;
+    size_t length = size < available ? size : available;
+
+    if (memcmp(dest->buffer, reference, length) != 0 || size > available)
+    {
+        // 只在不同的这一块内逐字节查找；输出比参考数据长时，不同之处为参考数据的末尾
+        size_t offset = 0;
+        while (offset < length && dest->buffer[offset] == reference[offset])
+            ++offset;
+        target->mismatch_offset = (int64_t)(dest->compared + offset);
+        longjmp(target->stop_point, 1);
+    }
+    dest->compared += size;
+}
+
+static void initCompareDestination(j_compress_ptr cinfo)
+{
+    compareDestinationMgr *dest = (compareDestinationMgr *)cinfo->dest;
+    dest->buffer = (JOCTET *)(*cinfo->mem->alloc_small)((j_common_ptr)cinfo, JPOOL_IMAGE, COMPARE_BUFFER_SIZE);
+    dest->compared = 0;
+    dest->target->mismatch_offset = -1;
+    dest->pub.next_output_byte = dest->buffer;
+    dest->pub.free_in_buffer = COMPARE_BUFFER_SIZE;
+}
+
+static boolean emptyCompareOutputBuffer(j_compress_ptr cinfo)
+{
+    compareDestinationMgr *dest = (compareDestinationMgr *)cinfo->dest;
+    compareOutputBytes(dest, COMPARE_BUFFER_SIZE);
+    dest->pub.next_output_byte = dest->buffer;
+    dest->pub.free_in_buffer = COMPARE_BUFFER_SIZE;
+    return TRUE;
+}
+
+static void termCompareDestination(j_compress_ptr cinfo)
+{
+    compareDestinationMgr *dest = (compareDestinationMgr *)cinfo->dest;
+    compareOutputBytes(dest, COMPARE_BUFFER_SIZE - dest->pub.free_in_buffer);
+
+    // 输出比参考数据短时，不同之处为输出的末尾
+    if (dest->compared != dest->target->reference_size)
+    {
+        dest->target->mismatch_offset = (int64_t)dest->compared;
+        longjmp(dest->target->stop_point, 1);
+    }
+}
+
+/**
+ * @brief 将JPEG数据逐块与参考数据比较而不写出 (用于内存中的加解密校验)
+ * @param cinfo 压缩结构体
+ * @param target 比较目标，须在压缩结束前保持有效，其 stop_point 须已调用 setjmp
+ */
+void jpegCompareDest(j_compress_ptr cinfo, compareTarget &target)
+{
+    if (cinfo->dest == NULL)
+    {
+        cinfo->dest = (struct jpeg_destination_mgr *)(*cinfo->mem->alloc_small)((j_common_ptr)cinfo, JPOOL_PERMANENT,
+                                                                                sizeof(compareDestinationMgr));
+    }
+
+    compareDestinationMgr *dest = (compareDestinationMgr *)cinfo->dest;
+    dest->pub.init_destination = initCompareDestination;
+    dest->pub.empty_output_buffer = emptyCompareOutputBuffer;
+    dest->pub.term_destination = termCompareDestination;
+    dest->target = &target;
+}
@@ -0,0 +1,125 @@
+#ifndef JPEGIO_H
+#define JPEGIO_H
+
+#include <stdio.h> // jpeglib.h 需要 FILE 与 size_t
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+
+#include "jpeglib.h" // 数据源/目标管理器
+
+/* 只读内存映射的输入文件：libjpeg 直接从映射区读取，不经过 stdio 的缓冲与复制 */
+class MappedInput
+{
+private:
+    const unsigned char *m_data;
+    size_t m_size;
+
+public:
+    MappedInput() : m_data(NULL), m_size(0) {}
+    ~MappedInput();
+
+    MappedInput(const MappedInput &) = delete;
+    MappedInput &operator=(const MappedInput &) = delete;
+
+    /**
+     * @brief 映射整个文件
+     * @param file_name 文件路径
+     * @return 失败时返回 false 并保留 errno
+     */
+    bool open(const char *file_name);
+
+    const unsigned char *data() const
+    {
+        return m_data;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+};
+
+/* 输出文件：按预估大小 fallocate 后映射为可写内存，libjpeg 直接写入映射区，
+ * 结束时截断为实际长度。不支持映射的文件退化为对齐的内存缓冲区，结束时一次 write 写出。
+ */
+class MappedOutput
+{
+private:
+    int m_fd;
+    unsigned char *m_data;
+    size_t m_capacity;
+    bool m_mapped; // true 表示 m_data 为文件映射，false 表示对齐的堆缓冲区
+
+public:
+    MappedOutput() : m_fd(-1), m_data(NULL), m_capacity(0), m_mapped(false) {}
+    ~MappedOutput();
+
+    MappedOutput(const MappedOutput &) = delete;
+    MappedOutput &operator=(const MappedOutput &) = delete;
+
+    /**
+     * @brief 创建 (或截断) 输出文件并预留空间
+     * @param file_name 文件路径
+     * @param size_hint 预估的输出大小，不足时自动扩大
+     * @return 失败时返回 false 并保留 errno
+     */
+    bool open(const char *file_name, size_t size_hint);
+
+    /**
+     * @brief 将容量扩大到至少 capacity，已写入的数据保持不变
+     * @return 失败时返回 false 并保留 errno
+     */
+    bool reserve(size_t capacity);
+
+    /**
+     * @brief 以实际长度结束输出：截断文件 (或写出缓冲区) 并关闭
+     * @param size 实际写入的字节数
+     * @return 失败时返回 false 并保留 errno
+     */
+    bool finish(size_t size);
+
+    unsigned char *data() const
+    {
+        return m_data;
+    }
+
+    size_t capacity() const
+    {
+        return m_capacity;
+    }
+};
+
+/* 比较目标：压缩输出不写出，而是逐块与参考数据比较。
+ * 发现第一个不同字节后 longjmp 到 stop_point 提前结束压缩，调用者须先对 stop_point 调用 setjmp。
+ */
+typedef struct
+{
+    const unsigned char *reference; // 参考数据 (例如原始文件的映射区)
+    size_t reference_size;
+    int64_t mismatch_offset; // 输出：第一个不同字节的偏移，-1 表示完全相同
+    jmp_buf stop_point;
+} compareTarget;
+
+/* libjpeg 错误管理器：默认的 error_exit 会终止进程，这里改为 longjmp 到 setjmp_buffer，由调用者清理并返回错误。
+ * 调用者须在调用可能出错的 libjpeg 函数之前对 setjmp_buffer 调用 setjmp。
+ */
+typedef struct
+{
+    struct jpeg_error_mgr pub;
+    jmp_buf setjmp_buffer;
+} jpegJumpErrorMgr;
+
+// 初始化错误管理器 (与 jpeg_std_error 相同，只是出错时跳回 setjmp_buffer)，返回 &err->pub
+struct jpeg_error_mgr *jpegJumpError(jpegJumpErrorMgr *err);
+
+// 从内存映射的输入文件读取JPEG数据 (替代 jpeg_stdio_src)
+void jpegMappedSrc(j_decompress_ptr cinfo, const MappedInput &input);
+
+// 将JPEG数据写入预分配的输出文件 (替代 jpeg_stdio_dest)，压缩结束时自动调用 output.finish()
+void jpegMappedDest(j_compress_ptr cinfo, MappedOutput &output);
+
+// 将JPEG数据逐块与参考数据比较而不写出 (用于内存中的加解密校验)
+void jpegCompareDest(j_compress_ptr cinfo, compareTarget &target);
+
+#endif // JPEGIO_H
@@ -4,7 +4,9 @@
 #include <bitset>
 #include <jpeglib.h>
 #include <vector>
-#include <cstdlib>
+#include <cstring>
+
+#include "zigzag.h" // countNonZeroAc
 
 /**
  * @brief 将哈希值 (64字节) 转换为布尔值向量 (512比特)
@@ -26,55 +28,54 @@ void Key::byteToBool(byte (&hash)[CryptoPP::SHA3_512::DIGESTSIZE], std::vector<b
 }
 
 /**
- * @brief 获取图像特征，这里使用非零AC系数的数量统计作为图像特征。
- * @param filename 图像文件路径
+ * @brief 从已读取的DCT系数中获取图像特征，统计Y分量每个块非零AC系数的数量。
+ * @param cinfo 已调用 jpeg_read_coefficients 的解压缩结构体
+ * @param coef_arrays jpeg_read_coefficients 返回的虚拟块数组
  * @param ss 字符串流，用于存储生成的图像特征字符串
  */
-void Key::getImageFeature(const std::string &filename, std::stringstream &ss)
+void Key::getImageFeature(j_decompress_ptr cinfo, jvirt_barray_ptr *coef_arrays, std::stringstream &ss)
 {
     // 用于存储每个块非零AC系数数量的统计
     std::vector<int> vec(64, 0);
-    // 打开JPEG文件
-    FILE *infile = fopen(filename.c_str(), "rb");
-    if (!infile) {
-        // 打不开文件，填充随机特征，保证流程可跑通
-        for (int i = 0; i < 64; ++i) vec[i] = rand() % 100;
-        for (size_t i = 0; i < vec.size(); ++i) ss << (int)i << vec[i];
-        return;
-    }
-    struct jpeg_decompress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    cinfo.err = jpeg_std_error(&jerr);
-    jpeg_create_decompress(&cinfo);
-    jpeg_stdio_src(&cinfo, infile);
-    jpeg_read_header(&cinfo, TRUE);
-    // 只获取DCT系数，不要调用 jpeg_start_decompress
-    jvirt_barray_ptr *coef_arrays = jpeg_read_coefficients(&cinfo);
     JBLOCKARRAY buffer;
     JBLOCKROW blockptr;
     int comp_id = 0; // Y分量
-    jpeg_component_info *compptr = cinfo.comp_info + comp_id;
+    jpeg_component_info *compptr = cinfo->comp_info + comp_id;
     int width_in_blocks = compptr->width_in_blocks;
     int height_in_blocks = compptr->height_in_blocks;
     for (int row = 0; row < height_in_blocks; ++row) {
-        buffer = (cinfo.mem->access_virt_barray)
-            ((j_common_ptr)&cinfo, coef_arrays[comp_id], row, 1, FALSE);
+        buffer = (cinfo->mem->access_virt_barray)
+            ((j_common_ptr)cinfo, coef_arrays[comp_id], row, 1, FALSE);
         blockptr = buffer[0];
         for (int col = 0; col < width_in_blocks; ++col) {
-            int count = 0;
             // 统计AC系数（跳过[0]）
-            for (int k = 1; k < 64; ++k) {
-                if (blockptr[col][k] != 0) ++count;
-            }
+            int count = countNonZeroAc(blockptr[col]);
             if (count >= 0 && count < 64) ++vec[count];
         }
     }
-    jpeg_destroy_decompress(&cinfo);
-    fclose(infile);
     // 将统计结果写入字符串流作为图像特征
     for (size_t i = 0; i < vec.size(); ++i) ss << (int)i << vec[i];
 }
 
+/**
+ * @brief 从Y分量的系数块中获取图像特征，统计方式与上面的函数相同。
+ * @param blocks Y分量的系数块
+ * @param width_in_blocks Y分量的块宽度
+ * @param height_in_blocks Y分量的块高度
+ * @param ss 字符串流，用于存储生成的图像特征字符串
+ */
+void Key::getImageFeature(JBLOCKARRAY blocks, JDIMENSION width_in_blocks, JDIMENSION height_in_blocks, std::stringstream &ss)
+{
+    std::vector<int> vec(64, 0);
+    for (JDIMENSION row = 0; row < height_in_blocks; ++row) {
+        for (JDIMENSION col = 0; col < width_in_blocks; ++col) {
+            int count = countNonZeroAc(blocks[row][col]);
+            if (count >= 0 && count < 64) ++vec[count];
+        }
+    }
+    for (size_t i = 0; i < vec.size(); ++i) ss << (int)i << vec[i];
+}
+
 /**
  * @brief 对图像特征字符串进行哈希。
  * 使用 SHA3-512 算法生成 512 比特 (64 字节) 的哈希值。
@@ -172,22 +173,45 @@ void Key::initializeKey(std::vector<bool> &hashBool)
 }
 
 /**
- * @brief Key 类的构造函数。
- * 根据提供的图像文件路径，计算图像特征，哈希，然后初始化混沌系统参数。
- * @param filename 图像文件路径
+ * @brief 对图像特征进行哈希，然后初始化混沌系统参数。
+ * @param ss 包含图像特征的字符串流
  */
-Key::Key(const std::string filename)
+void Key::initializeFromFeature(const std::stringstream &ss)
 {
-    std::stringstream ss;
-    getImageFeature(filename, ss); // 获取图像特征
-
     byte hash[CryptoPP::SHA3_512::DIGESTSIZE]; // 存储哈希值
     std::vector<bool> hashBool;                // 存储哈希值的布尔比特序列
 
     imageHash(ss, hash);        // 对特征进行哈希
     byteToBool(hash, hashBool); // 将哈希字节转换为布尔比特序列
+    memcpy(m_digest, hash, HASHLEN);
 
     assert(hashBool.size() == 512); // 确保哈希比特序列长度为512
 
     initializeKey(hashBool); // 使用哈希比特序列初始化密钥
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Key 类的构造函数。
+ * 直接使用已读取的DCT系数计算图像特征，避免再次打开和解码文件。
+ * @param cinfo 已调用 jpeg_read_coefficients 的解压缩结构体
+ * @param coef_arrays jpeg_read_coefficients 返回的虚拟块数组
+ */
+Key::Key(j_decompress_ptr cinfo, jvirt_barray_ptr *coef_arrays)
+{
+    std::stringstream ss;
+    getImageFeature(cinfo, coef_arrays, ss); // 获取图像特征
+    initializeFromFeature(ss);
+}
+/**
+ * @brief Key 类的构造函数。
+ * 直接使用Y分量的系数块计算图像特征 (例如内置的JPEG解码器得到的系数)。
+ * @param blocks Y分量的系数块
+ * @param width_in_blocks Y分量的块宽度
+ * @param height_in_blocks Y分量的块高度
+ */
+Key::Key(JBLOCKARRAY blocks, JDIMENSION width_in_blocks, JDIMENSION height_in_blocks)
+{
+    std::stringstream ss;
+    getImageFeature(blocks, width_in_blocks, height_in_blocks, ss); // 获取图像特征
+    initializeFromFeature(ss);
+}
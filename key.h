@@ -5,6 +5,8 @@
 #include <string>
 #include <vector>
 
+#include <stdio.h>
+#include "jpeglib.h"       // 引用 jpeglib 库，用于读取DCT系数
 #include "gmpxx.h"         // 引用 GMP++ 库，用于高精度浮点数
 #include <cryptopp/sha3.h> // 引用 Crypto++ SHA3 库
 
@@ -23,17 +25,33 @@ typedef unsigned char byte;
 class Key
 {
 private:
-    mpf_class m_x; // 混沌系统 Logistic Map 的初始参数 x0
-    mpf_class m_u; // 混沌系统 Logistic Map 的参数 u
+    mpf_class m_x;          // 混沌系统 Logistic Map 的初始参数 x0
+    mpf_class m_u;          // 混沌系统 Logistic Map 的参数 u
+    byte m_digest[HASHLEN]; // 图像特征的 SHA3-512 哈希值 (密钥流模式的密钥)
 
 private:
     /**
-     * @brief 获取图像特征。
-     * 这里使用非零AC系数的数量统计作为图像特征。
-     * @param filename 图像文件路径
+     * @brief 从已读取的DCT系数中获取图像特征 (不重新打开和解码文件)。
+     * @param cinfo 已调用 jpeg_read_coefficients 的解压缩结构体
+     * @param coef_arrays jpeg_read_coefficients 返回的虚拟块数组
      * @param ss 字符串流，用于存储生成的图像特征字符串
      */
-    void getImageFeature(const std::string &filename, std::stringstream &ss);
+    void getImageFeature(j_decompress_ptr cinfo, jvirt_barray_ptr *coef_arrays, std::stringstream &ss);
+
+    /**
+     * @brief 从Y分量的系数块中获取图像特征 (系数不来自 libjpeg 的虚拟块数组时使用)。
+     * @param blocks Y分量的系数块
+     * @param width_in_blocks Y分量的块宽度
+     * @param height_in_blocks Y分量的块高度
+     * @param ss 字符串流，用于存储生成的图像特征字符串
+     */
+    void getImageFeature(JBLOCKARRAY blocks, JDIMENSION width_in_blocks, JDIMENSION height_in_blocks, std::stringstream &ss);
+
+    /**
+     * @brief 对图像特征进行哈希并初始化 m_x 和 m_u。
+     * @param ss 包含图像特征的字符串流
+     */
+    void initializeFromFeature(const std::stringstream &ss);
 
     /**
      * @brief 对图像特征字符串进行哈希。
@@ -59,23 +77,38 @@ private:
 
 public:
     // 获取混沌系统的初始参数 x0
-    mpf_class getX()
+    mpf_class getX() const
     {
         return m_x;
     }
 
     // 获取混沌系统的参数 u
-    mpf_class getU()
+    mpf_class getU() const
     {
         return m_u;
     }
 
+    // 获取图像特征的哈希值 (HASHLEN 字节)
+    const byte *getDigest() const
+    {
+        return m_digest;
+    }
+
+    /**
+     * @brief 构造函数，根据已读取的DCT系数生成密钥。
+     * 图像特征在置乱前后保持不变，因此每幅图像只需计算一次，所有分量共用。
+     * @param cinfo 已调用 jpeg_read_coefficients 的解压缩结构体
+     * @param coef_arrays jpeg_read_coefficients 返回的虚拟块数组
+     */
+    Key(j_decompress_ptr cinfo, jvirt_barray_ptr *coef_arrays);
+
     /**
-     * @brief 构造函数，根据图像文件生成密钥。
-     * 这是 Key 类的唯一构造函数。
-     * @param filename 图像文件路径
+     * @brief 构造函数，根据Y分量的系数块生成密钥 (与上面的构造函数得到相同的密钥)。
+     * @param blocks Y分量的系数块
+     * @param width_in_blocks Y分量的块宽度
+     * @param height_in_blocks Y分量的块高度
      */
-    Key(const std::string filename);
+    Key(JBLOCKARRAY blocks, JDIMENSION width_in_blocks, JDIMENSION height_in_blocks);
 };
 
 #endif // KEY_H
\ No newline at end of file
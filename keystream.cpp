@@ -0,0 +1,115 @@
+#include "keystream.h"
+
+#include <string.h>
+
+#include <cryptopp/chacha.h> // 引用 Crypto++ ChaCha20
+
+// 每批生成的值的数量 (密钥流缓冲区位于栈上，共 4 KB)
+#define KEYSTREAM_BATCH_VALUES 256
+
+// APP11 标记码
+#define SCHEME_MARKER_CODE 0xEB
+
+/**
+ * @brief 按小端顺序读取 8 字节
+ * @param bytes 输入字节
+ * @return 64 位无符号整数
+ */
+static inline uint64_t loadLittleEndian64(const unsigned char *bytes)
+{
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i)
+        value = (value << 8) | bytes[i];
+    return value;
+}
+
+/**
+ * @brief 构造函数
+ * @param key KEYSTREAM_KEY_SIZE 字节的密钥
+ */
+KeystreamGenerator::KeystreamGenerator(const unsigned char *key)
+{
+    memcpy(m_key, key, KEYSTREAM_KEY_SIZE);
+}
+
+/**
+ * @brief 取出第 stream_id 条流中从第 first 个值开始的 n 个 128 位值
+ * 每个值由流中连续的 16 字节按小端顺序组成：前 8 字节为低 64 位，后 8 字节为高 64 位。
+ * @param stream_id 流编号 (KeystreamId)
+ * @param first 第一个值在流中的序号
+ * @param n 值的数量
+ * @param key_hi 输出：每个值的高 64 位
+ * @param key_lo 输出：每个值的低 64 位
+ */
+void KeystreamGenerator::values(uint64_t stream_id, size_t first, size_t n, uint64_t *key_hi, uint64_t *key_lo) const
+{
+    unsigned char nonce[8];
+    for (int i = 0; i < 8; ++i)
+        nonce[i] = (unsigned char)(stream_id >> (8 * i));
+
+    CryptoPP::ChaCha::Encryption cipher;
+    cipher.SetKeyWithIV(m_key, KEYSTREAM_KEY_SIZE, nonce, sizeof(nonce));
+    cipher.Seek((CryptoPP::lword)first * KEYSTREAM_VALUE_SIZE);
+
+    // 对全零数据加密即得到密钥流
+    unsigned char buffer[KEYSTREAM_BATCH_VALUES * KEYSTREAM_VALUE_SIZE];
+    for (size_t done = 0; done < n; done += KEYSTREAM_BATCH_VALUES)
+    {
+        size_t count = n - done < KEYSTREAM_BATCH_VALUES ? n - done : KEYSTREAM_BATCH_VALUES;
+        memset(buffer, 0, count * KEYSTREAM_VALUE_SIZE);
+        cipher.ProcessString(buffer, count * KEYSTREAM_VALUE_SIZE);
+        for (size_t i = 0; i < count; ++i)
+        {
+            key_lo[done + i] = loadLittleEndian64(buffer + i * KEYSTREAM_VALUE_SIZE);
+            key_hi[done + i] = loadLittleEndian64(buffer + i * KEYSTREAM_VALUE_SIZE + 8);
+        }
+    }
+}
+
+/**
+ * @brief 生成方案版本标记的内容 (不含标记码与长度字段)
+ * @param version 方案版本 (SchemeVersion)
+ * @param payload 输出：SCHEME_MARKER_LENGTH 字节
+ */
+void schemeMarkerPayload(int version, unsigned char *payload)
+{
+    memcpy(payload, SCHEME_MARKER_ID, sizeof(SCHEME_MARKER_ID)); // 含结尾的 0
+    payload[SCHEME_MARKER_LENGTH - 1] = (unsigned char)version;
+}
+
+/**
+ * @brief 在JPEG文件头 (SOS 之前) 中查找方案版本标记
+ * 只按标记段的长度字段跳过各段，不解析段的内容；数据不完整时视为没有标记。
+ * @param data JPEG数据
+ * @param size 数据的字节数
+ * @return 标记中的版本号，没有标记时返回 SCHEME_VERSION_LEGACY
+ */
+int readSchemeVersion(const unsigned char *data, size_t size)
+{
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+        return SCHEME_VERSION_LEGACY;
+
+    size_t pos = 2;
+    while (pos + 4 <= size)
+    {
+        if (data[pos] != 0xFF)
+            return SCHEME_VERSION_LEGACY;
+        unsigned char marker = data[pos + 1];
+        if (marker == 0xFF) // 填充字节
+        {
+            ++pos;
+            continue;
+        }
+        if (marker == 0xDA || marker == 0xD9) // SOS 或 EOI：文件头结束
+            return SCHEME_VERSION_LEGACY;
+
+        size_t length = ((size_t)data[pos + 2] << 8) | data[pos + 3];
+        if (length < 2 || pos + 2 + length > size)
+            return SCHEME_VERSION_LEGACY;
+        if (marker == SCHEME_MARKER_CODE && length - 2 == SCHEME_MARKER_LENGTH &&
+            memcmp(data + pos + 4, SCHEME_MARKER_ID, sizeof(SCHEME_MARKER_ID)) == 0)
+            return data[pos + 4 + SCHEME_MARKER_LENGTH - 1];
+        pos += 2 + length;
+    }
+    return SCHEME_VERSION_LEGACY;
+}
@@ -0,0 +1,80 @@
+#ifndef KEYSTREAM_H
+#define KEYSTREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ChaCha20 的密钥长度 (字节)，取自图像特征 SHA3-512 哈希值的前 32 字节
+#define KEYSTREAM_KEY_SIZE 32
+
+// 密钥流中每个值占用的字节数 (一个 128 位排序键)
+#define KEYSTREAM_VALUE_SIZE 16
+
+/* 密钥流模式下各置乱表使用的流编号 (ChaCha20 的 64 位 nonce)。
+ * 每个置乱表一条独立的流，不同置乱表之间没有先后依赖。
+ */
+enum KeystreamId
+{
+    STREAM_DCC_SIGN = 0,       // DCC相同符号分组置乱
+    STREAM_MCU = 1,            // MCU全局置乱
+    STREAM_DCC_ITER = 0x100,   // DCC迭代交换，加上迭代序号 (从 0 开始)
+    STREAM_RUN_CLASS = 0x200   // ACC相同游程置乱，加上游程长度
+};
+
+/**
+ * @brief 计数器模式的密钥流 (Crypto++ ChaCha20)
+ * 流中任意位置的值都可以直接定位计算，因此同一置乱表的不同分块、不同置乱表都可以并行生成。
+ * 对象本身只保存密钥，可以被多个线程同时使用。
+ */
+class KeystreamGenerator
+{
+private:
+    unsigned char m_key[KEYSTREAM_KEY_SIZE];
+
+public:
+    /**
+     * @brief 构造函数
+     * @param key KEYSTREAM_KEY_SIZE 字节的密钥
+     */
+    explicit KeystreamGenerator(const unsigned char *key);
+
+    /**
+     * @brief 取出第 stream_id 条流中从第 first 个值开始的 n 个 128 位值
+     * @param stream_id 流编号 (KeystreamId)
+     * @param first 第一个值在流中的序号
+     * @param n 值的数量
+     * @param key_hi 输出：每个值的高 64 位
+     * @param key_lo 输出：每个值的低 64 位
+     */
+    void values(uint64_t stream_id, size_t first, size_t n, uint64_t *key_hi, uint64_t *key_lo) const;
+};
+
+/* 方案版本：加密时写入密文的 APP11 标记 (标识字符串 "JPEGENC\0" 后跟 1 字节版本号)，
+ * 解密时据此选择随机来源。GMP 兼容模式不写标记 (与旧版本的输出相同)，没有该标记的密文由命令行或标志位指定的混沌模式解密。
+ */
+#define SCHEME_MARKER_ID "JPEGENC"
+#define SCHEME_MARKER_LENGTH 9 // 标识字符串 (含结尾的 0) 与版本号
+
+enum SchemeVersion
+{
+    SCHEME_VERSION_LEGACY = 0,    // GMP 兼容的混沌序列 (不写标记)
+    SCHEME_VERSION_KEYSTREAM = 1, // ChaCha20 密钥流
+    SCHEME_VERSION_FIXED128 = 2   // 128 位定点数混沌序列
+};
+
+/**
+ * @brief 生成方案版本标记的内容 (不含标记码与长度字段)
+ * @param version 方案版本 (SchemeVersion)
+ * @param payload 输出：SCHEME_MARKER_LENGTH 字节
+ */
+void schemeMarkerPayload(int version, unsigned char *payload);
+
+/**
+ * @brief 在JPEG文件头 (SOS 之前) 中查找方案版本标记
+ * @param data JPEG数据
+ * @param size 数据的字节数
+ * @return 标记中的版本号，没有标记时返回 SCHEME_VERSION_LEGACY
+ */
+int readSchemeVersion(const unsigned char *data, size_t size);
+
+#endif // KEYSTREAM_H
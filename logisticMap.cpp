@@ -0,0 +1,99 @@
+#include "logisticMap.h"
+
+#include <assert.h>
+#include <string.h>
+
+/**
+ * @brief 将 [0, 4) 范围内的 mpf_class 拆分为整数部分和 Q0.128 小数部分 (截断)
+ * @param value 待转换的高精度浮点数
+ * @param int_part 输出的整数部分
+ * @param frac_part 输出的 Q0.128 小数部分
+ */
+void mpfToFixed128(const mpf_class &value, uint64_t &int_part, fixed128 &frac_part)
+{
+    assert(value >= 0 && value < 4);
+
+    mpf_t temp;
+    mpf_init2(temp, mpf_get_prec(value.get_mpf_t()) + 192);
+    mpf_set(temp, value.get_mpf_t());
+
+    int_part = mpf_get_ui(temp);
+    mpf_sub_ui(temp, temp, int_part);
+    mpf_mul_2exp(temp, temp, 128);
+
+    mpz_t bits;
+    mpz_init(bits);
+    mpz_set_f(bits, temp);
+
+    // 以小端 64 位字导出，避免依赖 limb 宽度
+    uint64_t words[2] = {0, 0};
+    size_t count = 0;
+    mpz_export(words, &count, -1, sizeof(uint64_t), 0, 0, bits);
+    assert(count <= 2);
+    frac_part = ((fixed128)words[1] << 64) | words[0];
+
+    mpz_clear(bits);
+    mpf_clear(temp);
+}
+
+/**
+ * @brief LogisticMap 构造函数
+ * @param x0 初始值 x0 (来自 Key::getX())
+ * @param u 参数 u (来自 Key::getU())
+ * @param mode 生成模式 (ChaosMode)
+ */
+LogisticMap::LogisticMap(const mpf_class &x0, const mpf_class &u, int mode) : m_mode(mode)
+{
+    uint64_t x_int = 0;
+    mpfToFixed128(x0, x_int, m_x);
+    mpfToFixed128(u, m_u_int, m_u_frac);
+    assert(x_int == 0);
+
+    // 兼容模式：与原实现中 mpf_class x = key.getX() 等拷贝的精度保持一致
+    mpf_init2(m_gmp_x, mpf_get_prec(x0.get_mpf_t()));
+    mpf_set(m_gmp_x, x0.get_mpf_t());
+    mpf_init2(m_gmp_u, mpf_get_prec(u.get_mpf_t()));
+    mpf_set(m_gmp_u, u.get_mpf_t());
+    mpf_init2(m_gmp_temp, mpf_get_prec(m_gmp_x));
+}
+
+LogisticMap::~LogisticMap()
+{
+    mpf_clear(m_gmp_x);
+    mpf_clear(m_gmp_u);
+    mpf_clear(m_gmp_temp);
+}
+
+/**
+ * @brief 兼容模式下迭代一次 Logistic Map
+ *
+ * 逐步复现 gmpxx 对表达式 x = u * x * (1 - x) 的求值顺序：
+ * 先以 x 的精度计算临时量 (1 - x) = -(x - 1)，再计算 x = u * x，最后 x = x * temp。
+ * 因此得到的 x 与原 mpf_class 实现逐位相同。
+ * @return 新状态 x 截断到 128 位的小数部分 (Q0.128)
+ */
+fixed128 LogisticMap::nextCompat()
+{
+    mpf_sub_ui(m_gmp_temp, m_gmp_x, 1);
+    mpf_neg(m_gmp_temp, m_gmp_temp);
+    mpf_mul(m_gmp_x, m_gmp_u, m_gmp_x);
+    mpf_mul(m_gmp_x, m_gmp_x, m_gmp_temp);
+
+    // 直接读取 mpf 的 limb 提取小数部分的高 128 位，避免额外的 GMP 调用与内存分配。
+    // x 位于 (0, 1)，故 _mp_exp <= 0，-_mp_exp 为小数点后前导全零 limb 的个数。
+    mp_exp_t exp = m_gmp_x->_mp_exp;
+    int size = m_gmp_x->_mp_size;
+    assert(exp <= 0 && size >= 0);
+
+    fixed128 result = 0;
+    const mp_limb_t *limbs = m_gmp_x->_mp_d;
+    for (int i = size - 1; i >= 0; --i)
+    {
+        long position = -exp + (size - 1 - i); // 该 limb 在小数部分中的序号 (0 为最高)
+        long shift = 128 - (position + 1) * GMP_NUMB_BITS;
+        if (shift < 0)
+            break;
+        result |= (fixed128)limbs[i] << shift;
+    }
+    return result;
+}
@@ -0,0 +1,90 @@
+#ifndef LOGISTICMAP_H
+#define LOGISTICMAP_H
+
+#include <stdint.h>
+
+#include "gmpxx.h" // 引用 GMP++ 库，兼容模式下使用
+
+// Q0.128 定点数：表示 [0, 1) 区间内的值，value = raw / 2^128
+typedef unsigned __int128 fixed128;
+
+// 混沌序列生成模式
+enum ChaosMode
+{
+    CHAOS_GMP_COMPAT = 0, // 与原 mpf_class 实现逐位一致，可解密旧方案加密的文件
+    CHAOS_FIXED128 = 1,   // 纯 128 位定点运算，无内存分配，速度快但序列与 GMP 不同
+    CHAOS_KEYSTREAM = 2   // 不使用 Logistic Map：置乱表取自 ChaCha20 密钥流 (见 keystream.h 与 PermutationSource)
+};
+
+/**
+ * @brief Logistic Map 混沌序列生成器: x = u * x * (1 - x)
+ *
+ * 每次 next() 返回新状态 x 的高 128 位小数部分 (Q0.128)。
+ * 在两种模式下，返回值的大小顺序都与对应的实数序列一致，可直接用于排序。
+ */
+class LogisticMap
+{
+private:
+    int m_mode; // ChaosMode
+
+    // CHAOS_FIXED128 模式的状态
+    fixed128 m_x;      // 当前状态 x (Q0.128)
+    uint64_t m_u_int;  // 参数 u 的整数部分
+    fixed128 m_u_frac; // 参数 u 的小数部分 (Q0.128)
+
+    // CHAOS_GMP_COMPAT 模式的状态，构造时一次性初始化，迭代过程中不再分配内存
+    mpf_t m_gmp_x;
+    mpf_t m_gmp_u;
+    mpf_t m_gmp_temp;
+
+    LogisticMap(const LogisticMap &);
+    LogisticMap &operator=(const LogisticMap &);
+
+    fixed128 nextCompat();
+
+    // 截断乘法：近似计算 (a * b) >> 128，省略最低的 64x64 部分积 (误差不超过 2 个最低位)
+    static inline fixed128 mulHigh(fixed128 a, fixed128 b)
+    {
+        uint64_t a0 = (uint64_t)a, a1 = (uint64_t)(a >> 64);
+        uint64_t b0 = (uint64_t)b, b1 = (uint64_t)(b >> 64);
+        return (fixed128)a1 * b1 + (((fixed128)a0 * b1) >> 64) + (((fixed128)a1 * b0) >> 64);
+    }
+
+    // 截断平方：近似计算 (a * a) >> 128，交叉项只需一次乘法
+    static inline fixed128 squareHigh(fixed128 a)
+    {
+        uint64_t a0 = (uint64_t)a, a1 = (uint64_t)(a >> 64);
+        return (fixed128)a1 * a1 + ((((fixed128)a0 * a1) >> 64) << 1);
+    }
+
+public:
+    /**
+     * @brief 构造函数
+     * @param x0 初始值 x0 (来自 Key::getX())
+     * @param u 参数 u (来自 Key::getU())
+     * @param mode 生成模式 (ChaosMode)
+     */
+    LogisticMap(const mpf_class &x0, const mpf_class &u, int mode);
+    ~LogisticMap();
+
+    /**
+     * @brief 迭代一次 Logistic Map
+     * @return 新状态 x 的 Q0.128 定点表示
+     */
+    inline fixed128 next()
+    {
+        if (m_mode != CHAOS_FIXED128)
+            return nextCompat();
+
+        // x * (1 - x) = x - x^2，截断平方偏小，故 y 不会下溢
+        fixed128 y = m_x - squareHigh(m_x);
+        // u * y = u_int * y + u_frac * y，u < 4 且 y 约不超过 1/4，结果不会溢出
+        m_x = (fixed128)m_u_int * y + mulHigh(m_u_frac, y);
+        return m_x;
+    }
+};
+
+// 将 [0, 4) 范围内的 mpf_class 拆分为整数部分和 Q0.128 小数部分
+void mpfToFixed128(const mpf_class &value, uint64_t &int_part, fixed128 &frac_part);
+
+#endif // LOGISTICMAP_H
@@ -4,54 +4,382 @@
 #include <dirent.h> // 用于目录操作
 #include <string.h> // 用于字符串操作 (strcpy, strcat, strstr)
 #include <time.h>   // For clock() or time() (实际未使用，但通常用于性能计时)
+#include <errno.h>
+#include <sys/stat.h> // mkdir, stat
 
 #include <iostream> // For std::cout, std::cerr
+#include <sstream>  // 多线程批处理时缓存每张图像的输出
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic> // 多线程批处理时统计失败的图像数量
 
 #include "jpeglib.h" // JPEG库头文件
 
 #include "encryptAndDecrypt.h" // 加密解密方案头文件
 #include "sort.h"              // 排序辅助函数头文件
 #include "helper.h"            // 辅助函数头文件
+#include "threadPool.h"        // 工作窃取线程池
+#include "permutationCache.h"  // 置乱表缓存
 
-/* 图像通道数 (例如，1代表灰度，3代表RGB) */
-size_t channel;
+/* 运行模式：
+ * MODE_LEGACY    原调用方式 (只给出图像目录)：在原目录中生成 -enc/-dec 文件并校验
+ * MODE_ENCRYPT   只加密，输出到输出目录，文件名不变
+ * MODE_DECRYPT   只解密，输出到输出目录，文件名不变
+ * MODE_ROUNDTRIP 加密后再解密，在输出目录中生成 -enc/-dec 文件
+ * MODE_SELFCHECK 系数级自检：加密后立即解密并与原始系数比较，不写出任何文件
+ */
+enum RunMode
+{
+    MODE_LEGACY = 0,
+    MODE_ENCRYPT,
+    MODE_DECRYPT,
+    MODE_ROUNDTRIP,
+    MODE_SELFCHECK
+};
+
+/* 批处理任务参数 (所有图像共用) */
+typedef struct
+{
+    int mode;               // RunMode
+    const char *output_dir; // 输出目录 (MODE_LEGACY 时为 NULL，输出写在原图像旁；MODE_SELFCHECK 时为 NULL)
+    int verify;             // 非0时解密并与原图逐字节比较
+} batchJob;
+
+/**
+ * @brief 构建输出文件路径：<目录>/<原文件名去掉 .jpg><suffix>
+ * @param output_dir 输出目录，为 NULL 时使用原图像所在目录
+ * @param img_name 原始图像路径
+ * @param suffix 文件名后缀 (例如 "-enc.jpg" 或 ".jpg")
+ */
+static std::string outputPath(const char *output_dir, const char *img_name, const char *suffix)
+{
+    std::string base_name(img_name, strlen(img_name) - 4); // 减去 ".jpg" 的长度
+    if (output_dir)
+    {
+        size_t slash_pos = base_name.find_last_of("/\\");
+        base_name = std::string(output_dir) + "/" + base_name.substr(slash_pos == std::string::npos ? 0 : slash_pos + 1);
+    }
+    return base_name + suffix;
+}
+
+/**
+ * @brief 输出校验结果，不相等时报告第一个不同字节的位置
+ * @return passed
+ */
+static bool logVerification(std::ostream &log, const char *img_name, bool passed, int64_t mismatch_offset)
+{
+    if (!passed)
+    {
+        log << "Verification FAILED for: " << img_name;
+        if (mismatch_offset >= 0)
+            log << " (first mismatch at byte " << mismatch_offset << ")";
+        log << std::endl;
+    }
+    else
+    {
+        log << "Verification PASSED for: " << img_name << std::endl;
+    }
+    return passed;
+}
 
-/* DCT块的宽度 (行数) */
-size_t block_width;
+/**
+ * @brief 加密/解密出错时输出失败原因 (该图像的其余步骤随之跳过，批处理中的其余图像照常处理)
+ * @return status 为 SCHEME_OK 时返回 true
+ */
+static bool logSchemeStatus(std::ostream &log, const char *stage, const char *img_name, int status)
+{
+    if (status == SCHEME_OK)
+        return true;
+    log << stage << " FAILED for: " << img_name << " (" << schemeStatusString(status) << ")" << std::endl;
+    return false;
+}
 
-/* DCT块的高度 (列数) */
-size_t block_height;
+/**
+ * @brief 输出密文相对原图的大小变化 (用于权衡 --optimize-coding / --restart-interval 的效果)
+ */
+static void logSizeDelta(std::ostream &log, const char *img_name, const std::string &enc_name)
+{
+    int64_t src_size = fileSize(img_name);
+    int64_t enc_size = fileSize(enc_name);
+    if (src_size <= 0 || enc_size < 0)
+        return;
 
-/* 图像中DCT块的总数 */
-size_t block_sum;
+    char delta[64];
+    snprintf(delta, sizeof(delta), "%+lld bytes, %+.2f%%", (long long)(enc_size - src_size),
+             100.0 * (double)(enc_size - src_size) / (double)src_size);
+    log << "Size: " << src_size << " -> " << enc_size << " bytes (" << delta << ")" << std::endl;
+}
 
-/* Zigzag扫描顺序数组，用于AC系数的线性化和重构 */
-int zigzag[63] = {1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5, 12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7,
-                  14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53,
-                  60, 61, 54, 47, 55, 62, 63};
+/**
+ * @brief 解密 enc_name 到 dec_name 并与原图逐字节比较，输出校验结果
+ * @return 解密成功且与原图相同时返回 true
+ */
+static bool verifyImage(const char *img_name, const std::string &enc_name, const std::string &dec_name,
+                        const SchemeContext &options, std::ostream &log)
+{
+    log << "Decrypting: " << enc_name << " -> " << dec_name << std::endl;
+    int status = proposedEncryptionScheme(enc_name.c_str(), dec_name.c_str(), 1, options); // 1表示解密
+    if (!logSchemeStatus(log, "Decryption", enc_name.c_str(), status))
+        return false;
 
-/* 将要置乱的游程的最大数量 (0-62) */
-int ceiling_run = 63;
+    // 检查原始图像和解密后的图像是否相等
+    int64_t mismatch_offset = -1;
+    bool passed = isImageEqual(img_name, dec_name, &mismatch_offset, options.pool);
+    return logVerification(log, img_name, passed, mismatch_offset);
+}
 
-/* DCC迭代交换加密的最大迭代次数 */
-int iter_times = 15;
+/**
+ * @brief 按运行模式处理单张图像
+ * encrypt 与 roundtrip 的 --verify 在内存中完成：密文系数直接解密，重新编码的结果与原图逐块比较，不写出解密文件。
+ * @param img_name 输入图像路径
+ * @param options 加密方案参数
+ * @param job 批处理任务参数
+ * @param log 输出加解密过程和校验结果
+ * @return 全部步骤成功 (且自检、校验通过) 时返回 true
+ */
+static bool processImage(const char *img_name, const SchemeContext &options, const batchJob &job, std::ostream &log)
+{
+    int64_t mismatch_offset = -1;
+
+    if (job.mode == MODE_SELFCHECK)
+    {
+        selfCheckReport report;
+        if (!logSchemeStatus(log, "Self-check", img_name, selfCheckScheme(img_name, options, &report)))
+            return false;
+        if (report.mismatch_sum == 0)
+        {
+            log << "Self-check PASSED for: " << img_name << " (" << report.coef_sum << " coefficients)" << std::endl;
+        }
+        else
+        {
+            log << "Self-check FAILED for: " << img_name << " (" << report.mismatch_sum << " of " << report.coef_sum
+                << " coefficients differ, first at component " << report.component << " block (" << report.block_row
+                << ", " << report.block_col << ") coefficient " << report.coef_index << ")" << std::endl;
+        }
+        return report.mismatch_sum == 0;
+    }
 
-/* 量化DC系数的有效范围上限 */
-int ceiling_dc;
-/* 量化DC系数的有效范围下限 */
-int floor_dc;
+    if (job.mode == MODE_ENCRYPT || job.mode == MODE_DECRYPT)
+    {
+        int is_decryption = job.mode == MODE_DECRYPT;
+        int verify_in_memory = job.verify && !is_decryption;
+        std::string out_name = outputPath(job.output_dir, img_name, ".jpg");
+        log << (is_decryption ? "Decrypting: " : "Encrypting: ") << img_name << " -> " << out_name << std::endl;
+        int status = proposedEncryptionScheme(img_name, out_name.c_str(), is_decryption, options, verify_in_memory ? &mismatch_offset : NULL);
+        const char *stage = status == SCHEME_VERIFY_ERROR ? "Verification" : (is_decryption ? "Decryption" : "Encryption");
+        if (!logSchemeStatus(log, stage, img_name, status))
+            return false;
+        if (!is_decryption)
+            logSizeDelta(log, img_name, out_name);
+
+        if (verify_in_memory)
+            return logVerification(log, img_name, mismatch_offset < 0, mismatch_offset);
+        return true;
+    }
+
+    // MODE_LEGACY / MODE_ROUNDTRIP：生成 -enc.jpg 与 -dec.jpg (例如: image-enc.jpg)
+    std::string enc_name = outputPath(job.output_dir, img_name, "-enc.jpg");
+    std::string dec_name = outputPath(job.output_dir, img_name, "-dec.jpg");
+
+    // roundtrip --verify：只写出密文，解密结果在内存中与原图比较
+    if (job.mode == MODE_ROUNDTRIP && job.verify)
+    {
+        log << "Encrypting: " << img_name << " -> " << enc_name << " (verifying in memory)" << std::endl;
+        int status = proposedEncryptionScheme(img_name, enc_name.c_str(), 0, options, &mismatch_offset); // 0表示加密
+        if (!logSchemeStatus(log, status == SCHEME_VERIFY_ERROR ? "Verification" : "Encryption", img_name, status))
+            return false;
+        logSizeDelta(log, img_name, enc_name);
+        return logVerification(log, img_name, mismatch_offset < 0, mismatch_offset);
+    }
+
+    // 执行加密
+    log << "Encrypting: " << img_name << " -> " << enc_name << std::endl;
+    int status = proposedEncryptionScheme(img_name, enc_name.c_str(), 0, options); // 0表示加密
+    if (!logSchemeStatus(log, "Encryption", img_name, status))
+        return false;
+    logSizeDelta(log, img_name, enc_name);
+
+    // 执行解密，原调用方式写出解密文件后逐字节校验
+    if (job.verify)
+        return verifyImage(img_name, enc_name, dec_name, options, log);
+
+    log << "Decrypting: " << enc_name << " -> " << dec_name << std::endl;
+    status = proposedEncryptionScheme(enc_name.c_str(), dec_name.c_str(), 1, options); // 1表示解密
+    return logSchemeStatus(log, "Decryption", enc_name.c_str(), status);
+}
 
 int main(int argc, char *argv[])
 {
+    // 加密方案参数，块尺寸等由 proposedEncryptionScheme 按分量填充
+    SchemeContext options;
+    int thread_num = 1;        // 批处理线程数，1 表示逐张串行处理
+    long cache_megabytes = -1; // 置乱表缓存的大小 (MB)，0 表示不缓存，-1 表示按处理方式选择默认值
+    batchJob job = {MODE_LEGACY, NULL, 0};
+
+    // 解析可选参数
+    int arg_index = 1;
+    while (arg_index < argc && strncmp(argv[arg_index], "--", 2) == 0)
+    {
+        if (strcmp(argv[arg_index], "--chaos") == 0 && arg_index + 1 < argc)
+        {
+            if (strcmp(argv[arg_index + 1], "gmp") == 0)
+                options.chaos_mode = CHAOS_GMP_COMPAT;
+            else if (strcmp(argv[arg_index + 1], "fixed128") == 0)
+                options.chaos_mode = CHAOS_FIXED128;
+            else if (strcmp(argv[arg_index + 1], "chacha20") == 0)
+                options.chaos_mode = CHAOS_KEYSTREAM;
+            else
+            {
+                fprintf(stderr, "Error: Unknown chaos mode '%s' (expected gmp, fixed128 or chacha20)\n", argv[arg_index + 1]);
+                exit(EXIT_FAILURE);
+            }
+            arg_index += 2;
+        }
+        else if (strcmp(argv[arg_index], "--parallel-components") == 0)
+        {
+            options.parallel_components = 1;
+            ++arg_index;
+        }
+        else if (strcmp(argv[arg_index], "--in-place") == 0)
+        {
+            options.in_place_permutation = 1;
+            ++arg_index;
+        }
+        else if (strcmp(argv[arg_index], "--fast-codec") == 0)
+        {
+            options.fast_codec = 1;
+            ++arg_index;
+        }
+        else if (strcmp(argv[arg_index], "--optimize-coding") == 0)
+        {
+            options.optimize_coding = 1;
+            ++arg_index;
+        }
+        else if (strcmp(argv[arg_index], "--restart-interval") == 0 && arg_index + 1 < argc)
+        {
+            // 重启间隔以 MCU 为单位，DRI 标记中为 16 位无符号数
+            char *end = NULL;
+            long interval = strtol(argv[arg_index + 1], &end, 10);
+            if (*argv[arg_index + 1] == '\0' || *end != '\0' || interval < 0 || interval > 65535)
+            {
+                fprintf(stderr, "Error: Invalid restart interval '%s' (expected 0-65535 MCUs)\n", argv[arg_index + 1]);
+                exit(EXIT_FAILURE);
+            }
+            options.restart_interval = (unsigned int)interval;
+            arg_index += 2;
+        }
+        else if (strcmp(argv[arg_index], "--max-memory") == 0 && arg_index + 1 < argc)
+        {
+            // libjpeg 虚拟块数组的内存上限，以 MB 为单位
+            char *end = NULL;
+            long megabytes = strtol(argv[arg_index + 1], &end, 10);
+            if (*argv[arg_index + 1] == '\0' || *end != '\0' || megabytes < 1 || megabytes > 1024 * 1024)
+            {
+                fprintf(stderr, "Error: Invalid memory limit '%s' (expected 1-1048576 MB)\n", argv[arg_index + 1]);
+                exit(EXIT_FAILURE);
+            }
+            options.max_memory = (size_t)megabytes * 1024 * 1024;
+            arg_index += 2;
+        }
+        else if (strcmp(argv[arg_index], "--permutation-cache") == 0 && arg_index + 1 < argc)
+        {
+            // 置乱表缓存的大小，以 MB 为单位
+            char *end = NULL;
+            cache_megabytes = strtol(argv[arg_index + 1], &end, 10);
+            if (*argv[arg_index + 1] == '\0' || *end != '\0' || cache_megabytes < 0 || cache_megabytes > 1024 * 1024)
+            {
+                fprintf(stderr, "Error: Invalid permutation cache size '%s' (expected 0-1048576 MB)\n", argv[arg_index + 1]);
+                exit(EXIT_FAILURE);
+            }
+            arg_index += 2;
+        }
+        else if (strcmp(argv[arg_index], "--verify") == 0)
+        {
+            job.verify = 1;
+            ++arg_index;
+        }
+        else if (strcmp(argv[arg_index], "--threads") == 0 && arg_index + 1 < argc)
+        {
+            char *end = NULL;
+            long threads = strtol(argv[arg_index + 1], &end, 10);
+            if (*argv[arg_index + 1] == '\0' || *end != '\0' || threads < 1 || threads > 1024)
+            {
+                fprintf(stderr, "Error: Invalid thread count '%s' (expected 1-1024)\n", argv[arg_index + 1]);
+                exit(EXIT_FAILURE);
+            }
+            thread_num = (int)threads;
+            arg_index += 2;
+        }
+        else
+        {
+            fprintf(stderr, "Error: Unknown option '%s'\n", argv[arg_index]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // 子命令：encrypt|decrypt|roundtrip <input_dir> <output_dir> 或 selfcheck <input_dir>；只给出目录时保持原调用方式
+    if (argc - arg_index == 2 && strcmp(argv[arg_index], "selfcheck") == 0)
+    {
+        job.mode = MODE_SELFCHECK;
+    }
+    else if (argc - arg_index == 3)
+    {
+        if (strcmp(argv[arg_index], "encrypt") == 0)
+            job.mode = MODE_ENCRYPT;
+        else if (strcmp(argv[arg_index], "decrypt") == 0)
+            job.mode = MODE_DECRYPT;
+        else if (strcmp(argv[arg_index], "roundtrip") == 0)
+            job.mode = MODE_ROUNDTRIP;
+    }
+
     // 检查命令行参数数量
-    if (argc < 2)
+    if (job.mode == MODE_LEGACY && argc - arg_index != 1)
     {
-        fprintf(stderr, "Usage: %s <image_directory_path>\n", argv[0]);
+        fprintf(stderr, "Usage: %s [options] <image_directory_path>\n"
+                        "       %s [options] encrypt|decrypt|roundtrip <input_dir> <output_dir>\n"
+                        "       %s [options] selfcheck <input_dir>\n"
+                        "Options: [--chaos gmp|fixed128|chacha20] [--parallel-components] [--in-place] [--fast-codec] [--threads N] [--verify]\n"
+                        "         [--optimize-coding] [--restart-interval MCUS] [--max-memory MB] [--permutation-cache MB]\n",
+                argv[0], argv[0], argv[0]);
         exit(EXIT_FAILURE);
     }
 
+    if (job.mode == MODE_LEGACY)
+    {
+        job.verify = 1; // 原调用方式总是校验
+    }
+    else if (job.mode == MODE_SELFCHECK)
+    {
+        ++arg_index; // 跳过子命令，argv[arg_index] 为输入目录 (自检本身就是校验，忽略 --verify)
+    }
+    else
+    {
+        if (job.mode == MODE_DECRYPT && job.verify)
+        {
+            fprintf(stderr, "Error: --verify needs the original images and is not supported by decrypt\n");
+            exit(EXIT_FAILURE);
+        }
+
+        // 创建输出目录；encrypt/decrypt 输出与输入同名，因此不能与输入目录相同
+        job.output_dir = argv[arg_index + 2];
+        if (mkdir(job.output_dir, 0755) != 0 && errno != EEXIST)
+        {
+            fprintf(stderr, "Error: Could not create output directory '%s': %s\n", job.output_dir, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        struct stat input_stat, output_stat;
+        if (job.mode != MODE_ROUNDTRIP && stat(argv[arg_index + 1], &input_stat) == 0 && stat(job.output_dir, &output_stat) == 0 &&
+            input_stat.st_dev == output_stat.st_dev && input_stat.st_ino == output_stat.st_ino)
+        {
+            fprintf(stderr, "Error: Output directory must differ from the input directory\n");
+            exit(EXIT_FAILURE);
+        }
+        ++arg_index; // 跳过子命令，argv[arg_index] 为输入目录
+    }
+
     // 复制命令行参数中的路径，确保可修改
-    char *path_arg = argv[1];
+    char *path_arg = argv[arg_index];
     int path_length = strlen(path_arg);
     char *image_directory_path = (char *)malloc(sizeof(char) * (path_length + 1));
     if (!image_directory_path)
@@ -127,58 +455,65 @@ int main(int argc, char *argv[])
         closedir(directory_ptr); // 关闭目录句柄
     }
 
-    // 对每个图像进行加密和解密
-    for (int j = 0; j < image_num; ++j)
+    // 按文件名排序，保证报告顺序与目录遍历顺序无关
+    std::sort(image_ptr, image_ptr + image_num, [](const char *lhs, const char *rhs)
+              { return strcmp(lhs, rhs) < 0; });
+
+    // 加密后解密同一幅图像 (roundtrip、自检、校验) 时，解密直接使用加密时生成的置乱表
+    // 只有同一幅图像加密后立即解密时才会命中缓存，其余方式默认不缓存，避免每个分量额外保存一份置乱表
+    if (cache_megabytes < 0)
     {
-        char *img_name = image_ptr[j];
+        bool reuses_tables = job.mode == MODE_LEGACY || job.mode == MODE_ROUNDTRIP || job.mode == MODE_SELFCHECK || job.verify;
+        cache_megabytes = reuses_tables ? 64 : 0;
+    }
+    PermutationCache permutation_cache((size_t)cache_megabytes * 1024 * 1024);
+    if (cache_megabytes > 0)
+        options.permutation_cache = &permutation_cache;
 
-        // 构建加密后的文件名 (例如: image-enc.jpg)
-        size_t base_name_len = strlen(img_name) - 4;                          // 减去 ".jpg" 的长度
-        char *enc_name = (char *)malloc(sizeof(char) * (base_name_len + 10)); // 足够容纳 "-enc.jpg\0"
-        if (!enc_name)
+    std::atomic<int> failure_num(0); // 处理失败或自检、校验未通过的图像数量
+    if (thread_num <= 1)
+    {
+        // 对每个图像进行加密和解密
+        for (int j = 0; j < image_num; ++j)
         {
-            perror("Failed to allocate memory for enc_name");
-            continue; // 跳过当前图像
+            if (!processImage(image_ptr[j], options, job, std::cout))
+                ++failure_num;
         }
-        strncpy(enc_name, img_name, base_name_len);
-        enc_name[base_name_len] = '\0'; // 终止字符串
-        strcat(enc_name, "-enc.jpg");
-
-        // 执行加密
-        std::cout << "Encrypting: " << img_name << " -> " << enc_name << std::endl;
-        proposedEncryptionScheme(img_name, enc_name, 0); // 0表示加密
-
-        // 构建解密后的文件名 (例如: image-dec.jpg)
-        char *dec_name = (char *)malloc(sizeof(char) * (base_name_len + 10)); // 足够容纳 "-dec.jpg\0"
-        if (!dec_name)
+    }
+    else
+    {
+        // 大图像优先调度，避免最后只剩一张大图像在单个线程上执行
+        std::vector<int> schedule(image_num);
+        std::vector<int64_t> image_size(image_num);
+        for (int j = 0; j < image_num; ++j)
         {
-            perror("Failed to allocate memory for dec_name");
-            free(enc_name); // 释放已分配的enc_name
-            continue;       // 跳过当前图像
+            schedule[j] = j;
+            image_size[j] = fileSize(image_ptr[j]);
         }
-        strncpy(dec_name, img_name, base_name_len);
-        dec_name[base_name_len] = '\0';
-        strcat(dec_name, "-dec.jpg");
-
-        // 执行解密
-        std::cout << "Decrypting: " << enc_name << " -> " << dec_name << std::endl;
-        proposedEncryptionScheme(enc_name, dec_name, 1); // 1表示解密
+        std::stable_sort(schedule.begin(), schedule.end(), [&image_size](int lhs, int rhs)
+                         { return image_size[lhs] > image_size[rhs]; });
 
-        // 检查原始图像和解密后的图像是否相等
-        if (!isImageEqual(img_name, dec_name))
+        // 每张图像的输出先写入各自的缓冲区，全部完成后按文件名顺序输出
+        std::vector<std::ostringstream> reports(image_num);
         {
-            std::cout << "Verification FAILED for: " << img_name << std::endl;
-        }
-        else
-        {
-            std::cout << "Verification PASSED for: " << img_name << std::endl;
+            WorkStealingPool pool(thread_num);
+            SchemeContext pool_options = options;
+            pool_options.pool = &pool; // 图像内部的并行任务也交给同一个线程池
+            for (int j = 0; j < image_num; ++j)
+            {
+                int index = schedule[j];
+                pool.submit([&, index]
+                            {
+                                if (!processImage(image_ptr[index], pool_options, job, reports[index]))
+                                    ++failure_num;
+                            });
+            }
+            pool.wait();
         }
 
-        // 释放为当前图像文件名分配的内存
-        free(enc_name);
-        enc_name = NULL;
-        free(dec_name);
-        dec_name = NULL;
+        for (int j = 0; j < image_num; ++j)
+            std::cout << reports[j].str();
+        std::cout.flush();
     }
 
     // 释放所有图像文件路径的内存
@@ -194,6 +529,11 @@ int main(int argc, char *argv[])
     image_directory_path = NULL;
 
     std::cout << "Processed " << image_num << " images in directory: " << path_arg << std::endl;
+    if (failure_num > 0)
+    {
+        std::cout << failure_num.load() << " of " << image_num << " images FAILED." << std::endl;
+        return EXIT_FAILURE;
+    }
     std::cout << "Program finished successfully." << std::endl;
     return 0;
 }
\ No newline at end of file
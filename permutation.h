@@ -0,0 +1,92 @@
+#ifndef PERMUTATION_H
+#define PERMUTATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * @brief 取得当前线程的访问标记位图，并清零前 n 位
+ * 位图容量只增不减，同一线程内的多次原地置换共用。
+ * @param n 需要的位数
+ * @return 位图 (每个 uint64_t 存 64 位)
+ */
+inline uint64_t *visitedBitset(size_t n)
+{
+    static thread_local std::vector<uint64_t> bitset;
+    size_t words = (n + 63) / 64;
+    if (bitset.size() < words)
+        bitset.resize(words);
+    for (size_t i = 0; i < words; ++i)
+        bitset[i] = 0;
+    return bitset.data();
+}
+
+/**
+ * @brief 原地收集置换：data[i] <- 原 data[source_of(i)]
+ * 将置换分解为若干个环，沿每个环依次搬移元素，只需一个临时元素和 n 位的访问标记，
+ * 结果与先复制到临时数组再收集完全相同。
+ * @param data 待置换的元素数组
+ * @param n 元素数量
+ * @param source_of 函数对象，source_of(i) 为写入位置 i 的元素的原始位置
+ */
+template <typename T, typename SourceOf>
+void gatherInPlace(T *data, size_t n, SourceOf source_of)
+{
+    uint64_t *visited = visitedBitset(n);
+    for (size_t start = 0; start < n; ++start)
+    {
+        if (visited[start >> 6] & (1ULL << (start & 63)))
+            continue;
+
+        // 沿环 start -> source_of(start) -> ... 移动，直到回到 start
+        T temp = data[start];
+        size_t current = start;
+        for (;;)
+        {
+            visited[current >> 6] |= 1ULL << (current & 63);
+            size_t source = source_of(current);
+            if (source == start)
+            {
+                data[current] = temp;
+                break;
+            }
+            data[current] = data[source];
+            current = source;
+        }
+    }
+}
+
+/**
+ * @brief 原地分散置换：原 data[i] -> data[target_of(i)]
+ * 与 gatherInPlace 互为逆操作，使用同一个映射即可撤销收集置换。
+ * @param data 待置换的元素数组
+ * @param n 元素数量
+ * @param target_of 函数对象，target_of(i) 为位置 i 的元素的目标位置
+ */
+template <typename T, typename TargetOf>
+void scatterInPlace(T *data, size_t n, TargetOf target_of)
+{
+    uint64_t *visited = visitedBitset(n);
+    for (size_t start = 0; start < n; ++start)
+    {
+        if (visited[start >> 6] & (1ULL << (start & 63)))
+            continue;
+
+        // 手中的元素原本位于 start，依次放到目标位置并拿起被替换的元素
+        visited[start >> 6] |= 1ULL << (start & 63);
+        T carried = data[start];
+        size_t target = target_of(start);
+        while (target != start)
+        {
+            visited[target >> 6] |= 1ULL << (target & 63);
+            T displaced = data[target];
+            data[target] = carried;
+            carried = displaced;
+            target = target_of(target);
+        }
+        data[start] = carried;
+    }
+}
+
+#endif // PERMUTATION_H
@@ -0,0 +1,200 @@
+#include "permutationCache.h"
+
+#include <string.h>
+
+#include "encryptAndDecrypt.h" // SchemeContext
+#include "keystream.h"         // 流编号 KeystreamId
+
+/**
+ * @brief 置乱表占用的字节数 (每个位置的正向与逆向索引各 4 字节)
+ * @return 字节数
+ */
+size_t PermutationTables::bytes() const
+{
+    size_t positions = dcc_sign.size() + mcu.size();
+    for (size_t i = 0; i < dcc_iter.size(); ++i)
+        positions += dcc_iter[i].size();
+    for (size_t i = 0; i < run_class.size(); ++i)
+        positions += run_class[i].size();
+    return positions * 2 * sizeof(uint32_t) + run_counts.size() * sizeof(uint32_t) + sizeof(PermutationTables);
+}
+
+/**
+ * @brief 按加密时的顺序生成一个分量的全部置乱表
+ * 混沌模式下各置乱表依次从同一个混沌序列中取值，顺序必须是 rp1、rp2、rp3、rp4。
+ * @param ctx 加密方案上下文 (当前分量的块尺寸与方案参数)
+ * @param key 图像密钥
+ * @param run_index 已调用 scan() 的游程类别索引 (只使用各游程类别的系数数量)
+ * @param tables 输出的置乱表 (已有的容量被复用)
+ */
+void generatePermutationTables(const SchemeContext &ctx, const Key &key, const RunClassIndex &run_index, PermutationTables &tables)
+{
+    // 使用密钥中的初始参数 x 和 u 初始化混沌序列 (密钥流模式下以密钥中的哈希值为 ChaCha20 的密钥)
+    PermutationSource source(key, ctx.chaos_mode, ctx.pool);
+
+    if (tables.dcc_iter.size() < (size_t)ctx.iter_times)
+        tables.dcc_iter.resize(ctx.iter_times);
+    if (tables.run_class.size() < (size_t)ctx.ceiling_run)
+        tables.run_class.resize(ctx.ceiling_run);
+    tables.run_counts.resize(ctx.ceiling_run);
+    for (int run = 0; run < ctx.ceiling_run; ++run)
+        tables.run_counts[run] = (uint32_t)run_index.count(run);
+
+    // 1. DCC相同符号置乱
+    source.generate(tables.dcc_sign, STREAM_DCC_SIGN, ctx.block_sum);
+
+    // 2. DCC迭代交换：第 i 次迭代 (从 1 开始) 有 block_sum / (2i) 个分组
+    size_t block_sum = ctx.block_sum;
+    source.generateSeries(tables.dcc_iter, STREAM_DCC_ITER, ctx.iter_times, [block_sum](size_t iter_index)
+                          { return block_sum / ((iter_index + 1) * 2); });
+
+    // 3. ACC相同游程置乱：每个游程类别的长度为该类别的系数数量
+    const uint32_t *run_counts = tables.run_counts.data();
+    source.generateSeries(tables.run_class, STREAM_RUN_CLASS, ctx.ceiling_run, [run_counts](size_t run_val)
+                          { return (size_t)run_counts[run_val]; });
+
+    // 4. MCU全局置乱
+    source.generate(tables.mcu, STREAM_MCU, ctx.block_sum);
+}
+
+/**
+ * @brief 构造函数
+ * @param capacity 缓存的置乱表占用的字节数上限，0 表示不缓存
+ */
+PermutationCache::PermutationCache(size_t capacity)
+    : m_capacity(capacity), m_bytes(0)
+{
+}
+
+/**
+ * @brief 调整字节数上限，超出的部分立即淘汰
+ * @param capacity 字节数上限，0 表示不缓存
+ */
+void PermutationCache::setCapacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_capacity = capacity;
+    evict(m_capacity);
+    if (m_capacity == 0)
+        m_spare.reset();
+}
+
+/**
+ * @brief 从最久未使用的一端淘汰，直到占用的字节数不超过 limit (调用者持有 m_mutex)
+ * 只被缓存持有的置乱表 (其他持有者只能在持有 m_mutex 时从缓存取得) 留作备用。
+ * @param limit 字节数上限
+ */
+void PermutationCache::evict(size_t limit)
+{
+    while (m_bytes > limit && !m_lru.empty())
+    {
+        Entry &victim = m_lru.back();
+        m_bytes -= victim.tables->bytes();
+        if (victim.tables.use_count() == 1)
+            m_spare = victim.tables;
+        m_lru.pop_back();
+    }
+}
+
+/**
+ * @brief 判断缓存项是否对应当前分量
+ * 游程类别的系数数量来自图像内容，即使其余键相同也要逐项比较。
+ * @param entry 缓存项
+ * @param ctx 加密方案上下文
+ * @param key 图像密钥
+ * @param run_index 已调用 scan() 的游程类别索引
+ * @return 置乱表可以直接使用时返回 true
+ */
+bool PermutationCache::matches(const Entry &entry, const SchemeContext &ctx, const Key &key, const RunClassIndex &run_index)
+{
+    if (entry.block_width != ctx.block_width || entry.block_height != ctx.block_height || entry.chaos_mode != ctx.chaos_mode ||
+        entry.iter_times != ctx.iter_times || entry.ceiling_run != ctx.ceiling_run ||
+        memcmp(entry.digest, key.getDigest(), HASHLEN) != 0)
+        return false;
+
+    const uint32_t *run_counts = entry.tables->run_counts.data();
+    for (int run = 0; run < ctx.ceiling_run; ++run)
+    {
+        if (run_counts[run] != run_index.count(run))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 取得一个分量的置乱表，缓存中没有时生成并加入缓存
+ * 生成过程不持有锁，多个线程同时未命中同一项时各自生成，结果相同，只保留一份。
+ * 未命中时优先在备用的置乱表中生成，没有备用时才分配新的置乱表。
+ * @param ctx 加密方案上下文 (当前分量的块尺寸与方案参数)
+ * @param key 图像密钥
+ * @param run_index 已调用 scan() 的游程类别索引
+ * @return 置乱表 (不可修改)
+ */
+std::shared_ptr<const PermutationTables> PermutationCache::acquire(const SchemeContext &ctx, const Key &key, const RunClassIndex &run_index)
+{
+    std::shared_ptr<PermutationTables> tables;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (std::list<Entry>::iterator it = m_lru.begin(); it != m_lru.end(); ++it)
+        {
+            if (matches(*it, ctx, key, run_index))
+            {
+                m_lru.splice(m_lru.begin(), m_lru, it); // 移到最近使用的一端
+                return it->tables;
+            }
+        }
+        tables.swap(m_spare);
+    }
+
+    if (!tables)
+        tables = std::make_shared<PermutationTables>();
+    generatePermutationTables(ctx, key, run_index, *tables);
+    size_t bytes = tables->bytes();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (bytes > m_capacity)
+        return tables; // 单个分量的置乱表超过上限，不缓存
+    for (std::list<Entry>::iterator it = m_lru.begin(); it != m_lru.end(); ++it)
+    {
+        if (matches(*it, ctx, key, run_index))
+        {
+            m_spare = tables; // 其他线程已加入，刚生成的一份留作备用
+            return it->tables;
+        }
+    }
+
+    evict(m_capacity - bytes);
+    Entry entry;
+    memcpy(entry.digest, key.getDigest(), HASHLEN);
+    entry.block_width = ctx.block_width;
+    entry.block_height = ctx.block_height;
+    entry.chaos_mode = ctx.chaos_mode;
+    entry.iter_times = ctx.iter_times;
+    entry.ceiling_run = ctx.ceiling_run;
+    entry.tables = tables;
+    m_lru.push_front(entry);
+    m_bytes += bytes;
+    return tables;
+}
+
+/**
+ * @brief 取得一个分量的置乱表
+ * ctx.permutation_cache 为 NULL 时生成到 scratch 中 (复用其容量)，否则从缓存中取得。
+ * @param ctx 加密方案上下文 (当前分量的块尺寸与方案参数)
+ * @param key 图像密钥
+ * @param run_index 已调用 scan() 的游程类别索引
+ * @param scratch 不使用缓存时存放置乱表的对象
+ * @param holder 使用缓存时持有置乱表，返回的引用在 holder 被释放前有效
+ * @return 置乱表
+ */
+const PermutationTables &obtainPermutationTables(const SchemeContext &ctx, const Key &key, const RunClassIndex &run_index,
+                                                 PermutationTables &scratch, std::shared_ptr<const PermutationTables> &holder)
+{
+    if (!ctx.permutation_cache)
+    {
+        generatePermutationTables(ctx, key, run_index, scratch);
+        return scratch;
+    }
+    holder = ctx.permutation_cache->acquire(ctx, key, run_index);
+    return *holder;
+}
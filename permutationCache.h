@@ -0,0 +1,110 @@
+#ifndef PERMUTATIONCACHE_H
+#define PERMUTATIONCACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "sort.h"     // 混沌置乱表 ChaoticPermutation
+#include "runIndex.h" // 游程类别索引 RunClassIndex
+#include "key.h"      // HASHLEN
+
+struct SchemeContext; // 加密方案上下文，定义见 encryptAndDecrypt.h
+
+/**
+ * @brief 一个分量加密/解密所需的全部置乱表
+ * 置乱表只由密钥、分量尺寸、方案参数与各游程类别的系数数量决定，
+ * 这些量在加密前后都保持不变，因此加密与解密得到的置乱表完全相同。
+ */
+struct PermutationTables
+{
+    ChaoticPermutation dcc_sign;               // DCC相同符号置乱 (rp1)
+    std::vector<ChaoticPermutation> dcc_iter;  // DCC迭代交换，每次迭代一个 (rp2)
+    std::vector<ChaoticPermutation> run_class; // ACC相同游程置乱，每个游程类别一个 (rp3)
+    ChaoticPermutation mcu;                    // MCU全局置乱 (rp4)
+    std::vector<uint32_t> run_counts;          // 生成 run_class 时各游程类别的系数数量
+
+    // 置乱表占用的字节数 (用于限制缓存的大小)
+    size_t bytes() const;
+};
+
+/**
+ * @brief 按加密时的顺序生成一个分量的全部置乱表
+ * @param ctx 加密方案上下文 (当前分量的块尺寸与方案参数)
+ * @param key 图像密钥
+ * @param run_index 已调用 scan() 的游程类别索引 (只使用各游程类别的系数数量)
+ * @param tables 输出的置乱表 (已有的容量被复用)
+ */
+void generatePermutationTables(const SchemeContext &ctx, const Key &key, const RunClassIndex &run_index, PermutationTables &tables);
+
+/**
+ * @brief 置乱表的 LRU 缓存
+ * 以密钥的哈希值、分量的块尺寸、混沌模式、迭代次数与游程类别数为键，
+ * 同一幅图像加密后再解密 (roundtrip)，或同一幅密文被多次解密时，跳过混沌序列的生成与排序。
+ * 缓存的置乱表不可修改，以 shared_ptr 交给调用者，被淘汰后仍在使用的置乱表直到使用完毕才释放；
+ * 被淘汰时已不再使用的置乱表留作备用 (最多一份，不计入上限)，下一次未命中时在其中生成，复用其容量。
+ * 可以被多个线程同时使用。
+ */
+class PermutationCache
+{
+private:
+    struct Entry
+    {
+        unsigned char digest[HASHLEN];
+        size_t block_width;
+        size_t block_height;
+        int chaos_mode;
+        int iter_times;
+        int ceiling_run;
+        std::shared_ptr<PermutationTables> tables; // 交给调用者时转为不可修改
+    };
+
+    std::mutex m_mutex;                         // 保护以下状态
+    std::list<Entry> m_lru;                     // 最近使用的在前
+    size_t m_capacity;                          // 字节数上限，0 表示不缓存
+    size_t m_bytes;                             // 当前缓存的置乱表占用的字节数
+    std::shared_ptr<PermutationTables> m_spare; // 备用的置乱表 (可为空)
+
+    PermutationCache(const PermutationCache &);
+    PermutationCache &operator=(const PermutationCache &);
+
+    static bool matches(const Entry &entry, const SchemeContext &ctx, const Key &key, const RunClassIndex &run_index);
+    void evict(size_t limit);
+
+public:
+    /**
+     * @brief 构造函数
+     * @param capacity 缓存的置乱表占用的字节数上限，0 表示不缓存
+     */
+    explicit PermutationCache(size_t capacity);
+
+    // 调整字节数上限 (超出的部分立即淘汰)
+    void setCapacity(size_t capacity);
+
+    /**
+     * @brief 取得一个分量的置乱表，缓存中没有时生成并加入缓存
+     * @param ctx 加密方案上下文 (当前分量的块尺寸与方案参数)
+     * @param key 图像密钥
+     * @param run_index 已调用 scan() 的游程类别索引
+     * @return 置乱表 (不可修改)
+     */
+    std::shared_ptr<const PermutationTables> acquire(const SchemeContext &ctx, const Key &key, const RunClassIndex &run_index);
+};
+
+/**
+ * @brief 取得一个分量的置乱表
+ * ctx.permutation_cache 为 NULL 时生成到 scratch 中 (复用其容量)，否则从缓存中取得。
+ * @param ctx 加密方案上下文 (当前分量的块尺寸与方案参数)
+ * @param key 图像密钥
+ * @param run_index 已调用 scan() 的游程类别索引
+ * @param scratch 不使用缓存时存放置乱表的对象
+ * @param holder 使用缓存时持有置乱表，返回的引用在 holder 被释放前有效
+ * @return 置乱表
+ */
+const PermutationTables &obtainPermutationTables(const SchemeContext &ctx, const Key &key, const RunClassIndex &run_index,
+                                                 PermutationTables &scratch, std::shared_ptr<const PermutationTables> &holder);
+
+#endif // PERMUTATIONCACHE_H
@@ -0,0 +1,130 @@
+#include "runIndex.h"
+
+#include <assert.h>
+#include <algorithm>
+
+#include "zigzag.h"     // nonZeroMask
+#include "threadPool.h" // parallelFor
+
+static_assert(AC_STRIDE == 64, "packed entries assume a 64-coefficient block stride");
+
+// 通道 0..62 为AC系数，通道 63 为DC，不参与游程统计
+#define AC_LANE_MASK ((1ULL << (DCTSIZE2 - 1)) - 1)
+
+/**
+ * @brief 一次遍历所有块，生成非零位图并统计各游程类别的系数数量
+ * @param ac_ptr 当前分量AC系数缓冲区的起始地址 (块间隔为 AC_STRIDE)
+ * @param block_sum 块的数量
+ * @param ceiling_run 置乱的游程类别数，游程长度不小于它的系数不编入索引
+ * @return 块数超过 RUN_INDEX_MAX_BLOCKS 时返回 false (索引为空)
+ */
+bool RunClassIndex::scan(const JCOEF *ac_ptr, size_t block_sum, int ceiling_run)
+{
+    assert(ceiling_run >= 0 && ceiling_run <= DCTSIZE2 - 1);
+
+    m_ceiling_run = ceiling_run;
+    m_offsets.assign(ceiling_run + 1, 0);
+    if (block_sum > RUN_INDEX_MAX_BLOCKS)
+    {
+        m_masks.clear();
+        return false;
+    }
+    m_masks.resize(block_sum);
+
+    // 先在 m_offsets[run + 1] 处计数，之后原地转换为起始位置
+    uint32_t *count = m_offsets.data() + 1;
+    for (size_t block_index = 0; block_index < block_sum; ++block_index)
+    {
+        uint64_t mask = nonZeroMask(ac_ptr + block_index * AC_STRIDE) & AC_LANE_MASK;
+        m_masks[block_index] = mask;
+
+        // 相邻两个非零系数的通道差减一即为其间零系数的游程长度
+        int prev_lane = -1;
+        while (mask)
+        {
+            int lane = __builtin_ctzll(mask);
+            int run = lane - prev_lane - 1;
+            if (run < ceiling_run)
+                ++count[run];
+            prev_lane = lane;
+            mask &= mask - 1;
+        }
+    }
+
+    for (int run = 0; run < ceiling_run; ++run)
+        m_offsets[run + 1] += m_offsets[run];
+    return true;
+}
+
+/**
+ * @brief 块被整体置乱后同步调整非零位图，无需重新扫描系数
+ * @param source_of source_of[i] 为置乱后位置 i 处的块原来的位置
+ */
+void RunClassIndex::permuteBlocks(const uint32_t *source_of)
+{
+    m_permuted_masks.resize(m_masks.size());
+    for (size_t i = 0; i < m_masks.size(); ++i)
+        m_permuted_masks[i] = m_masks[source_of[i]];
+    m_masks.swap(m_permuted_masks);
+}
+
+/**
+ * @brief 由非零位图填充各游程类别的条目，需在 scan() 之后调用
+ */
+void RunClassIndex::buildEntries()
+{
+    m_entries.resize(m_offsets[m_ceiling_run]);
+
+    m_cursor.assign(m_offsets.begin(), m_offsets.end() - 1);
+    uint32_t *cursor = m_cursor.data();
+    for (size_t block_index = 0; block_index < m_masks.size(); ++block_index)
+    {
+        uint64_t mask = m_masks[block_index];
+        uint32_t block_base = (uint32_t)block_index << 6;
+        int prev_lane = -1;
+        while (mask)
+        {
+            int lane = __builtin_ctzll(mask);
+            int run = lane - prev_lane - 1;
+            if (run < m_ceiling_run)
+                m_entries[cursor[run]++] = block_base | lane;
+            prev_lane = lane;
+            mask &= mask - 1;
+        }
+    }
+}
+
+/**
+ * @brief 在每个游程类别内部按置换收集系数：类别 run 的第 i 个条目写入原第 source_of[run][i] 个条目的系数
+ * @param pool 线程池 (可为 NULL)
+ * @param source_of 每个游程类别的置换 (ceiling_run 项，条目数为 0 的类别不访问)
+ * @param ac_ptr 当前分量AC系数缓冲区的起始地址
+ * @param staging 暂存区 (至少 total() 项)
+ */
+void RunClassIndex::gather(WorkStealingPool *pool, const uint32_t *const *source_of, JCOEF *ac_ptr, JCOEF *staging) const
+{
+    const uint32_t *entries = m_entries.data();
+    const uint32_t *offsets = m_offsets.data();
+    int ceiling_run = m_ceiling_run;
+
+    // 1. 暂存所有条目的系数，暂存区下标与条目下标相同
+    parallelFor(pool, 0, total(), RUN_GATHER_GRAIN, [&](size_t begin, size_t end)
+                {
+        for (size_t entry = begin; entry < end; ++entry)
+            staging[entry] = ac_ptr[entries[entry]]; });
+
+    // 2. 每个条目从所属游程类别的暂存区收集，一个分块可能跨越多个游程类别
+    parallelFor(pool, 0, total(), RUN_GATHER_GRAIN, [&](size_t begin, size_t end)
+                {
+        // 起始条目所在的类别：最后一个起始位置不大于 begin 的类别
+        int run = (int)(std::upper_bound(offsets, offsets + ceiling_run + 1, (uint32_t)begin) - offsets) - 1;
+        for (size_t entry = begin; entry < end; ++run)
+        {
+            size_t class_begin = offsets[run];
+            size_t class_end = std::min((size_t)offsets[run + 1], end);
+            const uint32_t *source = source_of[run];
+            const JCOEF *class_staging = staging + class_begin;
+            for (; entry < class_end; ++entry)
+                ac_ptr[entries[entry]] = class_staging[source[entry - class_begin]];
+        } });
+}
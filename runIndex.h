@@ -0,0 +1,87 @@
+#ifndef RUNINDEX_H
+#define RUNINDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include "coefArena.h" // AC_STRIDE
+
+class WorkStealingPool; // 工作窃取线程池，定义见 threadPool.h
+
+// ACC相同游程置乱时每个并行任务处理的条目数
+#define RUN_GATHER_GRAIN 32768
+
+// 一个分量最多的块数：条目为 32 位，块序号占高 26 位
+#define RUN_INDEX_MAX_BLOCKS ((size_t)1 << 26)
+
+/* 按游程类别分组的非零AC系数索引 (CSR 格式)：
+ * 游程类别 run 的条目为 entries(run)[0 .. count(run))，按块序号、zigzag 位置升序排列。
+ * 每个条目是打包的 (块序号 << 6 | 通道)，由于 AC_STRIDE 为 64，它恰好等于系数在缓冲区中的下标。
+ * 块数超过 RUN_INDEX_MAX_BLOCKS 的分量无法编入索引，scan() 返回 false。
+ */
+class RunClassIndex
+{
+private:
+    int m_ceiling_run;
+    std::vector<uint64_t> m_masks;   // 每个块通道 0..62 的非零位图
+    std::vector<uint32_t> m_offsets; // 各游程类别在 m_entries 中的起始位置 (ceiling_run + 1 项)
+    std::vector<uint32_t> m_entries;
+
+    // permuteBlocks() 与 buildEntries() 的临时数据，容量在多次调用之间保留
+    std::vector<uint64_t> m_permuted_masks;
+    std::vector<uint32_t> m_cursor;
+
+public:
+    RunClassIndex() : m_ceiling_run(0) {}
+
+    /**
+     * @brief 一次遍历所有块，生成非零位图并统计各游程类别的系数数量
+     * @param ac_ptr 当前分量AC系数缓冲区的起始地址 (块间隔为 AC_STRIDE)
+     * @param block_sum 块的数量
+     * @param ceiling_run 置乱的游程类别数，游程长度不小于它的系数不编入索引
+     * @return 块数超过 RUN_INDEX_MAX_BLOCKS 时返回 false (索引为空)
+     */
+    bool scan(const JCOEF *ac_ptr, size_t block_sum, int ceiling_run);
+
+    /**
+     * @brief 块被整体置乱后同步调整非零位图，无需重新扫描系数
+     * @param source_of source_of[i] 为置乱后位置 i 处的块原来的位置
+     */
+    void permuteBlocks(const uint32_t *source_of);
+
+    // 由非零位图填充各游程类别的条目，需在 scan() 之后调用
+    void buildEntries();
+
+    // 游程类别 run 中非零AC系数的数量 (scan() 之后即可使用)
+    size_t count(int run) const
+    {
+        return m_offsets[run + 1] - m_offsets[run];
+    }
+
+    // 游程类别 run 的条目 (buildEntries() 之后可用)
+    const uint32_t *entries(int run) const
+    {
+        return m_entries.data() + m_offsets[run];
+    }
+
+    // 所有游程类别的条目总数
+    size_t total() const
+    {
+        return m_offsets[m_ceiling_run];
+    }
+
+    /**
+     * @brief 在每个游程类别内部按置换收集系数：类别 run 的第 i 个条目写入原第 source_of[run][i] 个条目的系数
+     * 先把所有条目的系数复制到暂存区 (与条目同样按类别连续排列)，再从暂存区收集回来。
+     * 两步都按条目数平均分块交给线程池，游程 0 等较大的类别被拆到多个任务中，各任务写入的位置互不重叠。
+     * 需在 buildEntries() 之后调用。
+     * @param pool 线程池 (可为 NULL)
+     * @param source_of 每个游程类别的置换 (ceiling_run 项，条目数为 0 的类别不访问)
+     * @param ac_ptr 当前分量AC系数缓冲区的起始地址
+     * @param staging 暂存区 (至少 total() 项)
+     */
+    void gather(WorkStealingPool *pool, const uint32_t *const *source_of, JCOEF *ac_ptr, JCOEF *staging) const;
+};
+
+#endif // RUNINDEX_H
@@ -1,46 +1,226 @@
 #include "sort.h"
 
-#include <stdio.h>
-
-// 这个文件在原始代码中是注释掉的，保持原样。
-// void swap(randSequence* rp, int low, int high)
-// {
-//     randSequence temp = *(rp + low);
-//     *(rp + low)  = *(rp + high);
-//     *(rp + high) = temp;
-// }
-
-// int partition(randSequence* rp, int low, int high)
-// {
-//     double privotKey = (rp + low)->value;
-//     while(low < high)
-//     {
-//         while((low < high) && ((rp+high)->value >= privotKey))
-//             -- high;
-
-//         swap(rp, low, high);
-//         while((low < high) && ((rp+low)->value <= privotKey))
-//             ++ low;
-
-//         swap(rp, low, high);
-//     }
-
-//     return low;
-// }
-
-// void quickSort(randSequence* rp, int low, int high)
-// {
-//     if(low < high)
-//     {
-//         int privotLoc = partition(rp, low, high);
-//         quickSort(rp, low, privotLoc-1);
-//         quickSort(rp, privotLoc+1, high);
-//     }
-// }
-
-// void printSeq(randSequence* rp, int length)
-// {
-//     int i;
-//     for(i = 0; i != length; ++ i)
-//         printf("%4d %f\n", (rp+i)->number, (rp+i)->value);
-// }
\ No newline at end of file
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+
+#include "key.h"        // 图像密钥
+#include "threadPool.h" // parallelFor
+
+// 基数排序每趟处理的位数，6 趟覆盖 64 位键
+#define RADIX_BITS 11
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_PASSES ((64 + RADIX_BITS - 1) / RADIX_BITS)
+
+// 少于该数量时直接使用比较排序，避免直方图开销
+#define RADIX_MIN_SIZE 64
+
+// 密钥流模式下并行生成排序键时每个分块的值数量 (1 MB 密钥流)
+#define KEYSTREAM_GRAIN 65536
+
+// 基数排序的元素：高 64 位键及其原始索引
+typedef struct
+{
+    uint64_t key;
+    uint32_t index;
+} radixItem;
+
+/**
+ * @brief 对 128 位键 (hi, lo) 做稳定的间接排序
+ * @param key_hi 键的高 64 位
+ * @param key_lo 键的低 64 位
+ * @param n 键的数量
+ * @param order 输出：order[rank] 为排名 rank 处元素的原始索引
+ */
+void radixArgsort(const uint64_t *key_hi, const uint64_t *key_lo, size_t n, uint32_t *order)
+{
+    assert(n <= UINT32_MAX);
+
+    // 比较函数：先比较高位，再比较低位，完全相同时按原始索引保证稳定
+    auto less_by_key = [key_hi, key_lo](uint32_t lhs, uint32_t rhs)
+    {
+        if (key_hi[lhs] != key_hi[rhs])
+            return key_hi[lhs] < key_hi[rhs];
+        if (key_lo[lhs] != key_lo[rhs])
+            return key_lo[lhs] < key_lo[rhs];
+        return lhs < rhs;
+    };
+
+    if (n < RADIX_MIN_SIZE)
+    {
+        for (size_t i = 0; i < n; ++i)
+            order[i] = i;
+        std::sort(order, order + n, less_by_key);
+        return;
+    }
+
+    // 每个线程复用自己的临时缓冲区
+    static thread_local std::vector<radixItem> items;
+    static thread_local std::vector<radixItem> items_temp;
+    static thread_local std::vector<uint32_t> histogram;
+    items.resize(n);
+    items_temp.resize(n);
+    histogram.assign(RADIX_PASSES * RADIX_SIZE, 0);
+
+    // 一次遍历同时统计所有趟的直方图
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint64_t key = key_hi[i];
+        items[i].key = key;
+        items[i].index = i;
+        for (int pass = 0; pass < RADIX_PASSES; ++pass)
+            ++histogram[pass * RADIX_SIZE + ((key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1))];
+    }
+
+    radixItem *src = items.data();
+    radixItem *dst = items_temp.data();
+    for (int pass = 0; pass < RADIX_PASSES; ++pass)
+    {
+        uint32_t *count = histogram.data() + pass * RADIX_SIZE;
+        int shift = pass * RADIX_BITS;
+
+        // 所有键在该位段上取值相同时跳过本趟
+        if (count[(src[0].key >> shift) & (RADIX_SIZE - 1)] == n)
+            continue;
+
+        // 直方图转换为各桶的起始位置
+        uint32_t offset = 0;
+        for (int bucket = 0; bucket < RADIX_SIZE; ++bucket)
+        {
+            uint32_t bucket_size = count[bucket];
+            count[bucket] = offset;
+            offset += bucket_size;
+        }
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            radixItem item = src[i];
+            dst[count[(item.key >> shift) & (RADIX_SIZE - 1)]++] = item;
+        }
+        std::swap(src, dst);
+    }
+
+    for (size_t i = 0; i < n; ++i)
+        order[i] = src[i].index;
+
+    // 高 64 位相同的区间 (极少出现) 再按低 64 位排序
+    for (size_t i = 0; i + 1 < n;)
+    {
+        size_t j = i + 1;
+        while (j < n && src[j].key == src[i].key)
+            ++j;
+        if (j - i > 1)
+            std::sort(order + i, order + j, less_by_key);
+        i = j;
+    }
+}
+
+/**
+ * @brief 从混沌序列中依次取 n 个值并生成置乱表
+ * @param chaos 混沌序列生成器 (状态会向前推进 n 步)
+ * @param n 置乱表长度
+ */
+void ChaoticPermutation::generate(LogisticMap &chaos, size_t n)
+{
+    static thread_local std::vector<uint64_t> key_hi;
+    static thread_local std::vector<uint64_t> key_lo;
+    key_hi.resize(n);
+    key_lo.resize(n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        fixed128 value = chaos.next();
+        key_hi[i] = (uint64_t)(value >> 64);
+        key_lo[i] = (uint64_t)value;
+    }
+
+    build(key_hi.data(), key_lo.data(), n);
+}
+
+/**
+ * @brief 从密钥流的第 stream_id 条流中取前 n 个值并生成置乱表
+ * @param keystream 密钥流
+ * @param stream_id 流编号 (KeystreamId)
+ * @param n 置乱表长度
+ * @param pool 线程池 (可为 NULL)
+ */
+void ChaoticPermutation::generate(const KeystreamGenerator &keystream, uint64_t stream_id, size_t n, WorkStealingPool *pool)
+{
+    static thread_local std::vector<uint64_t> key_hi;
+    static thread_local std::vector<uint64_t> key_lo;
+    key_hi.resize(n);
+    key_lo.resize(n);
+
+    // 各分块直接定位到流中的对应位置，互不依赖
+    uint64_t *hi = key_hi.data();
+    uint64_t *lo = key_lo.data();
+    parallelFor(pool, 0, n, KEYSTREAM_GRAIN, [&](size_t begin, size_t end)
+                { keystream.values(stream_id, begin, end - begin, hi + begin, lo + begin); });
+
+    build(hi, lo, n);
+}
+
+/**
+ * @brief 将 n 个 128 位键按从小到大排序，得到排名与原始索引之间的双向映射
+ * @param key_hi 键的高 64 位
+ * @param key_lo 键的低 64 位
+ * @param n 键的数量
+ */
+void ChaoticPermutation::build(const uint64_t *key_hi, const uint64_t *key_lo, size_t n)
+{
+    m_forward.resize(n);
+    m_inverse.resize(n);
+    radixArgsort(key_hi, key_lo, n, m_forward.data());
+    for (size_t rank = 0; rank < n; ++rank)
+        m_inverse[m_forward[rank]] = rank;
+}
+
+/**
+ * @brief 构造函数
+ * @param key 图像密钥 (混沌序列的初始参数与密钥流的密钥都来自它)
+ * @param mode 生成模式 (ChaosMode)
+ * @param pool 密钥流模式下并行生成使用的线程池 (可为 NULL)
+ */
+PermutationSource::PermutationSource(const Key &key, int mode, WorkStealingPool *pool)
+    : m_mode(mode), m_chaos(key.getX(), key.getU(), mode), m_keystream(key.getDigest()), m_pool(pool)
+{
+}
+
+/**
+ * @brief 生成一个置乱表
+ * @param rp 输出的置乱表
+ * @param stream_id 密钥流模式下使用的流编号 (KeystreamId)，混沌模式下忽略
+ * @param n 置乱表长度
+ */
+void PermutationSource::generate(ChaoticPermutation &rp, uint64_t stream_id, size_t n)
+{
+    if (m_mode == CHAOS_KEYSTREAM)
+        rp.generate(m_keystream, stream_id, n, m_pool);
+    else
+        rp.generate(m_chaos, n);
+}
+
+/**
+ * @brief 生成一组置乱表，第 i 个使用流 first_stream_id + i，长度为 size_of(i)
+ * @param rps 输出的置乱表 (至少 count 个)
+ * @param first_stream_id 第一个置乱表的流编号
+ * @param count 置乱表的数量
+ * @param size_of 函数对象，size_of(i) 为第 i 个置乱表的长度
+ */
+void PermutationSource::generateSeries(std::vector<ChaoticPermutation> &rps, uint64_t first_stream_id, size_t count,
+                                       const std::function<size_t(size_t)> &size_of)
+{
+    if (m_mode != CHAOS_KEYSTREAM)
+    {
+        // 混沌序列只能依次取值
+        for (size_t i = 0; i < count; ++i)
+            rps[i].generate(m_chaos, size_of(i));
+        return;
+    }
+
+    // 各置乱表使用独立的流，每个置乱表内部再按分块并行生成排序键
+    parallelFor(m_pool, 0, count, 1, [&](size_t begin, size_t end)
+                {
+        for (size_t i = begin; i < end; ++i)
+            rps[i].generate(m_keystream, first_stream_id + i, size_of(i), m_pool); });
+}
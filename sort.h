@@ -1,12 +1,121 @@
 #ifndef SORT_H
 #define SORT_H
 
-#include "encryptAndDecrypt.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <functional>
 
-// 以下函数在原始代码中被注释掉或未使用，实际使用了std::sort
-// void swap(randSequence* rp, int low, int high);
-// int  partition(randSequence* rp, int low, int high);
-// void quickSort(randSequence* rp, int low, int high);
-// void printSeq(randSequence* rp, int length);
+#include "logisticMap.h" // 混沌序列生成器
+#include "keystream.h"   // 计数器模式的密钥流
 
-#endif // SORT_H
\ No newline at end of file
+class Key;              // 密钥类，定义见 key.h
+class WorkStealingPool; // 工作窃取线程池，定义见 threadPool.h
+
+/**
+ * @brief 对 128 位键 (hi, lo) 做稳定的间接排序 (argsort)
+ * 先对高 64 位做 LSD 基数排序，再对高 64 位相同的少量区间按低 64 位细排，
+ * 结果与按完整 128 位键比较排序一致，键完全相同时保持原始索引顺序。
+ * @param key_hi 键的高 64 位
+ * @param key_lo 键的低 64 位
+ * @param n 键的数量
+ * @param order 输出：order[rank] 为排名 rank 处元素的原始索引
+ */
+void radixArgsort(const uint64_t *key_hi, const uint64_t *key_lo, size_t n, uint32_t *order);
+
+/**
+ * @brief 由混沌序列生成的置乱表
+ * 从混沌序列中取 n 个值，按值从小到大排序，得到排名与原始索引之间的双向映射。
+ * forward()[rank] 等价于原实现中排序后 rp[rank].number。
+ */
+class ChaoticPermutation
+{
+private:
+    std::vector<uint32_t> m_forward; // m_forward[rank] = 原始索引
+    std::vector<uint32_t> m_inverse; // m_inverse[原始索引] = rank
+
+    // 由 n 个 128 位键排序得到置乱表
+    void build(const uint64_t *key_hi, const uint64_t *key_lo, size_t n);
+
+public:
+    /**
+     * @brief 从混沌序列中依次取 n 个值并生成置乱表
+     * @param chaos 混沌序列生成器 (状态会向前推进 n 步)
+     * @param n 置乱表长度
+     */
+    void generate(LogisticMap &chaos, size_t n);
+
+    /**
+     * @brief 从密钥流的第 stream_id 条流中取前 n 个值并生成置乱表
+     * 各分块独立定位到自己在流中的位置，使用 pool 并行生成。
+     * @param keystream 密钥流
+     * @param stream_id 流编号 (KeystreamId)
+     * @param n 置乱表长度
+     * @param pool 线程池 (可为 NULL)
+     */
+    void generate(const KeystreamGenerator &keystream, uint64_t stream_id, size_t n, WorkStealingPool *pool);
+
+    // 排名 -> 原始索引
+    const uint32_t *forward() const
+    {
+        return m_forward.data();
+    }
+
+    // 原始索引 -> 排名
+    const uint32_t *inverse() const
+    {
+        return m_inverse.data();
+    }
+
+    size_t size() const
+    {
+        return m_forward.size();
+    }
+};
+
+/**
+ * @brief 置乱表的随机来源
+ * 混沌模式下所有置乱表依次从同一个混沌序列中取值，必须按固定顺序生成；
+ * 密钥流模式 (CHAOS_KEYSTREAM) 下每个置乱表使用一条独立的流，可以按任意顺序、并行生成，
+ * 两种模式下调用顺序与参数相同。
+ */
+class PermutationSource
+{
+private:
+    int m_mode;
+    LogisticMap m_chaos;
+    KeystreamGenerator m_keystream;
+    WorkStealingPool *m_pool;
+
+    PermutationSource(const PermutationSource &);
+    PermutationSource &operator=(const PermutationSource &);
+
+public:
+    /**
+     * @brief 构造函数
+     * @param key 图像密钥 (混沌序列的初始参数与密钥流的密钥都来自它)
+     * @param mode 生成模式 (ChaosMode)
+     * @param pool 密钥流模式下并行生成使用的线程池 (可为 NULL)
+     */
+    PermutationSource(const Key &key, int mode, WorkStealingPool *pool);
+
+    /**
+     * @brief 生成一个置乱表
+     * @param rp 输出的置乱表
+     * @param stream_id 密钥流模式下使用的流编号 (KeystreamId)，混沌模式下忽略
+     * @param n 置乱表长度
+     */
+    void generate(ChaoticPermutation &rp, uint64_t stream_id, size_t n);
+
+    /**
+     * @brief 生成一组置乱表，第 i 个使用流 first_stream_id + i，长度为 size_of(i)
+     * 混沌模式下按 i 从小到大依次生成，密钥流模式下各置乱表并行生成。
+     * @param rps 输出的置乱表 (至少 count 个)
+     * @param first_stream_id 第一个置乱表的流编号
+     * @param count 置乱表的数量
+     * @param size_of 函数对象，size_of(i) 为第 i 个置乱表的长度
+     */
+    void generateSeries(std::vector<ChaoticPermutation> &rps, uint64_t first_stream_id, size_t count, const std::function<size_t(size_t)> &size_of);
+};
+
+#endif // SORT_H
@@ -0,0 +1,576 @@
+/* 回归测试：内置编解码器与 libjpeg 路径的输出逐字节相同，解密恢复AC系数，各项性能选项不改变输出，
+ * SIMD 实现与标量实现的结果相同，库接口对无效输入返回相应的错误码。
+ * 与除 main.cpp 外的源文件一起编译 (见 README)，全部通过时返回 0。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "jpeglib.h" // JPEG库头文件
+
+#include "encryptAndDecrypt.h" // fastTransformJpeg, transformCoefficients, compressCoefficients
+#include "logisticMap.h"       // 混沌模式 ChaosMode
+#include "zigzag.h"            // blockToZigzag, zigzagToBlock, nonZeroMask
+#include "dccSwap.h"           // canSwapDccHalves
+#include "runIndex.h"          // RunClassIndex
+#include "dccGroups.h"         // splitSameSignGroups, deriveGroupOrder
+#include "permutationCache.h"  // PermutationCache
+#include "keystream.h"         // readSchemeVersion
+#include "jpegEncryptApi.h"    // encryptJpegBuffer, decryptJpegBuffer
+#include "threadPool.h"        // 并行解码各重启段、并行处理各分量
+
+static int failure_num = 0; // 未通过的检查数量
+
+/**
+ * @brief 记录一项检查的结果，未通过时输出说明
+ */
+static void check(bool passed, const char *name)
+{
+    if (!passed)
+    {
+        printf("FAILED: %s\n", name);
+        ++failure_num;
+    }
+}
+
+/*************************************************** 测试图像 ***************************************************/
+
+/* 测试图像的参数 */
+typedef struct
+{
+    const char *name;
+    int width;
+    int height;
+    int components;                // 1 为灰度，3 为 YCbCr
+    int h_samp_factor;             // 亮度分量的采样因子 (色度分量为 1)
+    int v_samp_factor;
+    unsigned int restart_interval; // 原图的重启间隔 (MCU 数)
+} testImage;
+
+/**
+ * @brief 用 libjpeg 压缩一幅合成图像 (渐变加噪声，使各分量都有非零的AC系数)
+ * @param spec 图像参数
+ * @return JPEG数据
+ */
+static std::vector<unsigned char> makeJpeg(const testImage &spec)
+{
+    struct jpeg_compress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    unsigned char *buffer = NULL;
+    unsigned long size = 0;
+
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+    jpeg_mem_dest(&cinfo, &buffer, &size);
+
+    cinfo.image_width = spec.width;
+    cinfo.image_height = spec.height;
+    cinfo.input_components = spec.components;
+    cinfo.in_color_space = spec.components == 1 ? JCS_GRAYSCALE : JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, 85, TRUE);
+    cinfo.comp_info[0].h_samp_factor = spec.h_samp_factor;
+    cinfo.comp_info[0].v_samp_factor = spec.v_samp_factor;
+    cinfo.restart_interval = spec.restart_interval;
+    jpeg_start_compress(&cinfo, TRUE);
+
+    std::mt19937 random(spec.width * 131 + spec.height);
+    std::vector<JSAMPLE> row((size_t)spec.width * spec.components);
+    while (cinfo.next_scanline < cinfo.image_height)
+    {
+        int y = cinfo.next_scanline;
+        for (int x = 0; x < spec.width; ++x)
+        {
+            for (int c = 0; c < spec.components; ++c)
+            {
+                int value = (x * (c + 2) + y * (3 - c)) % 256 + (int)(random() % 48) - 24;
+                row[(size_t)x * spec.components + c] = (JSAMPLE)(value < 0 ? 0 : value > 255 ? 255 : value);
+            }
+        }
+        JSAMPROW row_ptr = row.data();
+        jpeg_write_scanlines(&cinfo, &row_ptr, 1);
+    }
+
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+
+    std::vector<unsigned char> data(buffer, buffer + size);
+    free(buffer);
+    return data;
+}
+
+/**
+ * @brief 经 libjpeg 加密/解密内存中的JPEG数据 (与 proposedEncryptionScheme 的 libjpeg 路径相同)
+ * @param src 输入JPEG数据
+ * @param is_decryption 标志，0表示加密，1表示解密
+ * @param options 方案参数
+ * @return 输出JPEG数据
+ */
+static std::vector<unsigned char> libjpegTransform(const std::vector<unsigned char> &src, int is_decryption, const SchemeContext &options)
+{
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_compress_struct cinfo_enc;
+    struct jpeg_error_mgr jerr, jerr_enc;
+    unsigned char *buffer = NULL;
+    unsigned long size = 0;
+
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, src.data(), (unsigned long)src.size());
+    (void)jpeg_read_header(&cinfo, TRUE);
+    jvirt_barray_ptr *coeff = jpeg_read_coefficients(&cinfo);
+    transformCoefficients(&cinfo, coeff, is_decryption, options);
+
+    cinfo_enc.err = jpeg_std_error(&jerr_enc);
+    jpeg_create_compress(&cinfo_enc);
+    jpeg_mem_dest(&cinfo_enc, &buffer, &size);
+    if (is_decryption)
+        compressCoefficients(&cinfo, coeff, &cinfo_enc);
+    else
+        compressCoefficients(&cinfo, coeff, &cinfo_enc, options.optimize_coding, options.restart_interval, schemeVersion(options));
+    jpeg_destroy_compress(&cinfo_enc);
+    jpeg_destroy_decompress(&cinfo);
+
+    std::vector<unsigned char> data(buffer, buffer + size);
+    free(buffer);
+    return data;
+}
+
+/**
+ * @brief 内置编解码器与 libjpeg 对同一幅图像加密、解密的输出逐字节相同
+ * 内置编解码器必须真正处理了该图像 (没有退回 libjpeg)，否则比较没有意义。
+ * @param spec 图像参数
+ * @param pool 线程池，NULL 表示串行处理
+ */
+static void testFastCodec(const testImage &spec, WorkStealingPool *pool)
+{
+    std::vector<unsigned char> original = makeJpeg(spec);
+
+    static const int chaos_modes[] = {CHAOS_GMP_COMPAT, CHAOS_FIXED128, CHAOS_KEYSTREAM};
+    for (int mode = 0; mode < 3; ++mode)
+    {
+        for (int entropy = 0; entropy < 2; ++entropy)
+        {
+            SchemeContext options;
+            options.chaos_mode = chaos_modes[mode];
+            options.optimize_coding = entropy; // 第二轮同时检查优化的 Huffman 表与重启标记
+            options.restart_interval = entropy ? 3 : 0;
+            options.parallel_components = pool != NULL;
+            options.pool = pool;
+
+            char name[128];
+            snprintf(name, sizeof(name), "fast codec %s (chaos mode %d%s%s)", spec.name, chaos_modes[mode],
+                     entropy ? ", optimized coding, restart interval 3" : "", pool ? ", threaded" : "");
+
+            std::vector<unsigned char> fast_enc, fast_dec;
+            int64_t mismatch_offset = 0;
+            bool handled = fastTransformJpeg(original.data(), original.size(), 0, options, fast_enc, &mismatch_offset) == FAST_CODEC_DONE;
+            check(handled, name);
+            if (!handled)
+                continue;
+            std::vector<unsigned char> libjpeg_enc = libjpegTransform(original, 0, options);
+            check(fast_enc == libjpeg_enc, name);
+
+            handled = fastTransformJpeg(fast_enc.data(), fast_enc.size(), 1, options, fast_dec) == FAST_CODEC_DONE;
+            check(handled, name);
+            if (!handled)
+                continue;
+            std::vector<unsigned char> libjpeg_dec = libjpegTransform(libjpeg_enc, 1, options);
+            check(fast_dec == libjpeg_dec, name);
+
+            // 内存中校验的结果应与真正解密后逐字节比较的结果一致
+            int64_t expected_offset = -1;
+            if (libjpeg_dec != original)
+            {
+                size_t length = std::min(libjpeg_dec.size(), original.size());
+                expected_offset = 0;
+                while ((size_t)expected_offset < length && libjpeg_dec[expected_offset] == original[expected_offset])
+                    ++expected_offset;
+            }
+            check(mismatch_offset == expected_offset, name);
+        }
+    }
+}
+
+/*************************************************** 方案的可逆性与一致性 ***************************************************/
+
+/**
+ * @brief 读出JPEG数据中所有分量的DCT系数 (每个分量按块行依次排列)
+ * @param data JPEG数据
+ * @return 各分量的系数
+ */
+static std::vector<std::vector<JCOEF>> readCoefficients(const std::vector<unsigned char> &data)
+{
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, data.data(), (unsigned long)data.size());
+    (void)jpeg_read_header(&cinfo, TRUE);
+    jvirt_barray_ptr *coeff = jpeg_read_coefficients(&cinfo);
+
+    std::vector<std::vector<JCOEF>> coefficients(cinfo.num_components);
+    for (int co = 0; co < cinfo.num_components; ++co)
+    {
+        jpeg_component_info *comp_info = &cinfo.comp_info[co];
+        size_t row_length = (size_t)comp_info->width_in_blocks * DCTSIZE2;
+        coefficients[co].resize(row_length * comp_info->height_in_blocks);
+        for (JDIMENSION h = 0; h < comp_info->height_in_blocks; ++h)
+        {
+            JBLOCKARRAY row = (cinfo.mem->access_virt_barray)((j_common_ptr)&cinfo, coeff[co], h, 1, FALSE);
+            memcpy(coefficients[co].data() + h * row_length, row[0][0], sizeof(JCOEF) * row_length);
+        }
+    }
+
+    jpeg_destroy_decompress(&cinfo);
+    return coefficients;
+}
+
+/**
+ * @brief 解密恢复加密前的全部AC系数
+ * DC系数经DCC迭代交换后可能越过有效范围而被截断，这是原方案的已知行为，因此只要求AC系数逐个相同、DC系数有改变。
+ * @param spec 图像参数
+ */
+static void testRoundTrip(const testImage &spec)
+{
+    std::vector<unsigned char> original = makeJpeg(spec);
+    std::vector<std::vector<JCOEF>> original_coefficients = readCoefficients(original);
+
+    static const int chaos_modes[] = {CHAOS_GMP_COMPAT, CHAOS_FIXED128, CHAOS_KEYSTREAM};
+    for (int mode = 0; mode < 3; ++mode)
+    {
+        SchemeContext options;
+        options.chaos_mode = chaos_modes[mode];
+
+        char name[128];
+        snprintf(name, sizeof(name), "round trip %s (chaos mode %d)", spec.name, chaos_modes[mode]);
+
+        std::vector<unsigned char> encrypted = libjpegTransform(original, 0, options);
+        std::vector<std::vector<JCOEF>> encrypted_coefficients = readCoefficients(encrypted);
+        std::vector<std::vector<JCOEF>> restored_coefficients = readCoefficients(libjpegTransform(encrypted, 1, options));
+        check(encrypted_coefficients != original_coefficients, name);
+        check(restored_coefficients.size() == original_coefficients.size(), name);
+        if (restored_coefficients.size() != original_coefficients.size())
+            continue;
+
+        bool ac_restored = true;
+        for (size_t co = 0; co < original_coefficients.size(); ++co)
+        {
+            const std::vector<JCOEF> &expected = original_coefficients[co];
+            const std::vector<JCOEF> &restored = restored_coefficients[co];
+            ac_restored = ac_restored && restored.size() == expected.size();
+            for (size_t i = 0; ac_restored && i < expected.size(); ++i)
+                ac_restored = i % DCTSIZE2 == 0 || restored[i] == expected[i];
+        }
+        check(ac_restored, name);
+    }
+}
+
+/**
+ * @brief 原地置乱、并行处理分量与置乱表缓存 (未命中与命中) 都不改变密文与解密结果
+ * @param spec 图像参数
+ * @param pool 线程池
+ */
+static void testEquivalentOptions(const testImage &spec, WorkStealingPool *pool)
+{
+    std::vector<unsigned char> original = makeJpeg(spec);
+
+    static const int chaos_modes[] = {CHAOS_GMP_COMPAT, CHAOS_FIXED128, CHAOS_KEYSTREAM};
+    for (int mode = 0; mode < 3; ++mode)
+    {
+        SchemeContext reference_options;
+        reference_options.chaos_mode = chaos_modes[mode];
+        std::vector<unsigned char> reference_enc = libjpegTransform(original, 0, reference_options);
+        std::vector<unsigned char> reference_dec = libjpegTransform(reference_enc, 1, reference_options);
+
+        char name[128];
+        for (int variant = 0; variant < 4; ++variant)
+        {
+            SchemeContext options = reference_options;
+            options.in_place_permutation = variant & 1;
+            options.parallel_components = (variant >> 1) & 1;
+            options.pool = options.parallel_components ? pool : NULL;
+            snprintf(name, sizeof(name), "%s (chaos mode %d, in place %d, parallel components %d)", spec.name, chaos_modes[mode],
+                     options.in_place_permutation, options.parallel_components);
+
+            std::vector<unsigned char> enc = libjpegTransform(original, 0, options);
+            check(enc == reference_enc, name);
+            check(libjpegTransform(enc, 1, options) == reference_dec, name);
+        }
+
+        // 第一次加密未命中缓存，之后的加密与解密都直接使用缓存中的置乱表
+        PermutationCache cache(64 * 1024 * 1024);
+        SchemeContext options = reference_options;
+        options.permutation_cache = &cache;
+        snprintf(name, sizeof(name), "permutation cache %s (chaos mode %d)", spec.name, chaos_modes[mode]);
+        check(libjpegTransform(original, 0, options) == reference_enc, name);
+        check(libjpegTransform(original, 0, options) == reference_enc, name);
+        check(libjpegTransform(reference_enc, 1, options) == reference_dec, name);
+
+        // 上限小于一个分量的置乱表时每次都重新生成
+        cache.setCapacity(1);
+        check(libjpegTransform(reference_enc, 1, options) == reference_dec, name);
+    }
+}
+
+/*************************************************** SIMD 与标量实现 ***************************************************/
+
+/**
+ * @brief 生成一个随机块，density 为非零系数的比例 (百分比)
+ */
+static void randomBlock(std::mt19937 &random, int density, JCOEF *block)
+{
+    for (int i = 0; i < DCTSIZE2; ++i)
+        block[i] = (int)(random() % 100) < density ? (JCOEF)((int)(random() % 4095) - 2047) : 0;
+}
+
+/**
+ * @brief blockToZigzag、zigzagToBlock 与 nonZeroMask 的结果与按定义逐个计算的结果相同
+ */
+static void testZigzagKernels()
+{
+    std::mt19937 random(8);
+    bool to_zigzag = true, to_block = true, mask = true;
+    for (int round = 0; round < 20000; ++round)
+    {
+        JCOEF block[DCTSIZE2], lanes[DCTSIZE2], restored[DCTSIZE2];
+        randomBlock(random, round % 101, block);
+
+        blockToZigzag(block, lanes);
+        for (int lane = 0; lane < DCTSIZE2; ++lane)
+            to_zigzag = to_zigzag && lanes[lane] == block[zigzag_tables.forward[lane]];
+
+        zigzagToBlock(lanes, restored);
+        to_block = to_block && memcmp(restored, block, sizeof(block)) == 0;
+
+        uint64_t expected = 0;
+        for (int i = 0; i < DCTSIZE2; ++i)
+        {
+            if (block[i] != 0)
+                expected |= 1ULL << i;
+        }
+        mask = mask && nonZeroMask(block) == expected && countNonZeroAc(block) == __builtin_popcountll(expected & ~1ULL);
+    }
+    check(to_zigzag, "blockToZigzag matches the zigzag table");
+    check(to_block, "zigzagToBlock inverts blockToZigzag");
+    check(mask, "nonZeroMask matches the scalar mask");
+}
+
+/**
+ * @brief 标量参考实现：与原 dccIterSwap 中的判断相同，先逐个累加右半部分，再累加左半部分
+ */
+static int canSwapReference(const JCOEF *group_ptr, int half_size, int floor_dc, int ceiling_dc)
+{
+    int prev_dc = 0;
+    for (int i = 0; i < 2 * half_size; ++i)
+    {
+        prev_dc += group_ptr[(i + half_size) % (2 * half_size)];
+        if (prev_dc > ceiling_dc || prev_dc < floor_dc)
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief canSwapDccHalves (分组长度适合时使用 SIMD 实现) 与标量参考实现的判断相同
+ * DC差值的幅度随机选取，使部分和既有远离边界的，也有恰好落在边界上或越过边界的。
+ */
+static void testCanSwapDccHalves()
+{
+    std::mt19937 random(10);
+    static const int dc_steps[] = {1, 4, 16, 63};
+    bool matched = true;
+    for (int round = 0; round < 200000; ++round)
+    {
+        int dc_step = dc_steps[round % 4];
+        int ceiling_dc = (int)(1016.0 / dc_step + 0.5);
+        int floor_dc = -(int)(1024.0 / dc_step + 0.5);
+        int half_size = 1 + round % 20; // 包括退回标量实现的长度
+        int amplitude = 1 + (int)(random() % (2 * ceiling_dc / half_size + 2));
+
+        JCOEF group[40];
+        for (int i = 0; i < 2 * half_size; ++i)
+            group[i] = (JCOEF)((int)(random() % (2 * amplitude + 1)) - amplitude);
+
+        int expected = canSwapReference(group, half_size, floor_dc, ceiling_dc);
+        matched = matched && (canSwapDccHalves(group, half_size, floor_dc, ceiling_dc) != 0) == (expected != 0);
+    }
+    check(matched, "canSwapDccHalves matches the scalar check");
+}
+
+/*************************************************** 游程类别索引 ***************************************************/
+
+/**
+ * @brief 块数超过 RUN_INDEX_MAX_BLOCKS 的分量被拒绝 (不访问系数)，之后的分量照常编入索引
+ */
+static void testRunIndexLimit()
+{
+    RunClassIndex run_index;
+    check(!run_index.scan(NULL, RUN_INDEX_MAX_BLOCKS + 1, 20), "run index rejects components above RUN_INDEX_MAX_BLOCKS");
+
+    // 第 0 块：通道 0、3 非零 (游程 0、2)；第 1 块：通道 1 非零 (游程 1)
+    alignas(ARENA_ALIGNMENT) JCOEF blocks[2 * AC_STRIDE] = {0};
+    blocks[0] = 5;
+    blocks[3] = -1;
+    blocks[AC_STRIDE + 1] = 2;
+    bool indexed = run_index.scan(blocks, 2, 20);
+    check(indexed && run_index.count(0) == 1 && run_index.count(1) == 1 && run_index.count(2) == 1 && run_index.total() == 3,
+          "run index counts runs after a rejected component");
+}
+
+/*************************************************** DCC分组 ***************************************************/
+
+/**
+ * @brief deriveGroupOrder 与原实现 (对每个分组按全局置乱表的值排序) 的结果相同
+ */
+static void testDeriveGroupOrder()
+{
+    std::mt19937 random(11);
+    bool matched = true;
+    for (int round = 0; round < 200 && matched; ++round)
+    {
+        size_t n = 1 + random() % 2000;
+        std::vector<JCOEF> diff(n);
+        for (size_t i = 0; i < n; ++i)
+            diff[i] = (JCOEF)((int)(random() % 21) - 10);
+
+        std::vector<uint32_t> forward(n), inverse(n);
+        for (size_t i = 0; i < n; ++i)
+            forward[i] = (uint32_t)i;
+        std::shuffle(forward.begin(), forward.end(), random);
+        for (size_t i = 0; i < n; ++i)
+            inverse[forward[i]] = (uint32_t)i;
+
+        std::vector<uint32_t> group_offset(n + 2), group_of(n), cursor(n + 1), group_order(n);
+        size_t group_num = splitSameSignGroups(diff.data(), n, group_offset.data());
+        deriveGroupOrder(inverse.data(), n, group_offset.data(), group_num, group_of.data(), cursor.data(), group_order.data());
+
+        for (size_t g = 0; g < group_num && matched; ++g)
+        {
+            std::vector<std::pair<uint32_t, uint32_t>> pairs; // (置乱表的值, 分组内的索引)
+            for (uint32_t pos = group_offset[g]; pos < group_offset[g + 1]; ++pos)
+                pairs.push_back(std::make_pair(forward[pos], pos - group_offset[g]));
+            std::sort(pairs.begin(), pairs.end());
+            for (size_t i = 0; i < pairs.size(); ++i)
+                matched = matched && group_order[group_offset[g] + i] == pairs[i].second;
+        }
+    }
+    check(matched, "deriveGroupOrder matches sorting each group");
+}
+
+/*************************************************** 库接口 ***************************************************/
+
+/**
+ * @brief 调用 encryptJpegBuffer / decryptJpegBuffer，返回错误码，成功时输出数据
+ */
+static int apiTransform(const std::vector<unsigned char> &src, size_t src_size, unsigned int flags, int is_decryption,
+                        std::vector<unsigned char> &output)
+{
+    unsigned char *dst = NULL;
+    size_t dst_size = 0;
+    int status = is_decryption ? decryptJpegBuffer(src.data(), src_size, &dst, &dst_size, flags)
+                               : encryptJpegBuffer(src.data(), src_size, &dst, &dst_size, flags);
+    output.assign(dst, dst + dst_size);
+    if (status != JPEG_ENCRYPT_OK && dst != NULL)
+        output.assign(1, 0); // 失败时不应输出数据
+    freeJpegBuffer(dst);
+    return status;
+}
+
+/**
+ * @brief 库接口的输出与 libjpeg 路径相同，截断、无效的输入与冲突的标志位返回相应的错误码，
+ * 解密时根据方案版本标记自动选择随机来源，不认识的版本号被拒绝
+ */
+static void testApi()
+{
+    static const testImage spec = {"api", 96, 80, 3, 2, 2, 0};
+    std::vector<unsigned char> original = makeJpeg(spec);
+    std::vector<unsigned char> enc, dec, output;
+
+    SchemeContext options;
+    check(apiTransform(original, original.size(), 0, 0, enc) == JPEG_ENCRYPT_OK && enc == libjpegTransform(original, 0, options),
+          "api encryption matches libjpeg");
+    check(apiTransform(enc, enc.size(), 0, 1, dec) == JPEG_ENCRYPT_OK && dec == libjpegTransform(enc, 1, options),
+          "api decryption matches libjpeg");
+    check(apiTransform(original, original.size(), JPEG_ENCRYPT_FAST_CODEC, 0, output) == JPEG_ENCRYPT_OK && output == enc,
+          "api fast codec matches libjpeg");
+    check(readSchemeVersion(enc.data(), enc.size()) == SCHEME_VERSION_LEGACY, "gmp ciphertext has no scheme marker");
+
+    // 截断、无效与空的输入
+    check(apiTransform(original, original.size() / 2, 0, 0, output) == JPEG_ENCRYPT_DECODE_ERROR && output.empty(), "api rejects truncated input");
+    std::vector<unsigned char> garbage(4096);
+    std::mt19937 random(12);
+    for (size_t i = 0; i < garbage.size(); ++i)
+        garbage[i] = (unsigned char)random();
+    check(apiTransform(garbage, garbage.size(), 0, 0, output) == JPEG_ENCRYPT_DECODE_ERROR && output.empty(), "api rejects garbage input");
+    check(apiTransform(original, 0, 0, 0, output) == JPEG_ENCRYPT_INVALID_ARGUMENT, "api rejects empty input");
+    unsigned char *dst = NULL;
+    check(encryptJpegBuffer(NULL, original.size(), &dst, NULL, 0) == JPEG_ENCRYPT_INVALID_ARGUMENT, "api rejects null pointers");
+
+    // 冲突或未知的标志位
+    check(apiTransform(original, original.size(), JPEG_ENCRYPT_CHAOS_FIXED128 | JPEG_ENCRYPT_CHAOS_CHACHA20, 0, output) == JPEG_ENCRYPT_INVALID_ARGUMENT,
+          "api rejects conflicting chaos flags");
+    check(apiTransform(original, original.size(), 0x100, 0, output) == JPEG_ENCRYPT_INVALID_ARGUMENT, "api rejects unknown flags");
+
+    // 带标记的密文：解密时不指定混沌模式也能正确解密
+    static const unsigned int marked_flags[] = {JPEG_ENCRYPT_CHAOS_CHACHA20, JPEG_ENCRYPT_CHAOS_FIXED128};
+    static const int marked_versions[] = {SCHEME_VERSION_KEYSTREAM, SCHEME_VERSION_FIXED128};
+    for (int i = 0; i < 2; ++i)
+    {
+        std::vector<unsigned char> marked_enc, expected_dec;
+        check(apiTransform(original, original.size(), marked_flags[i], 0, marked_enc) == JPEG_ENCRYPT_OK, "api encryption with a scheme marker");
+        check(readSchemeVersion(marked_enc.data(), marked_enc.size()) == marked_versions[i], "scheme marker version");
+        check(apiTransform(marked_enc, marked_enc.size(), marked_flags[i], 1, expected_dec) == JPEG_ENCRYPT_OK &&
+                  apiTransform(marked_enc, marked_enc.size(), 0, 1, output) == JPEG_ENCRYPT_OK && output == expected_dec,
+              "api decryption selects the chaos mode from the scheme marker");
+
+        // 把版本号改为不认识的值
+        std::vector<unsigned char>::iterator id = std::search(marked_enc.begin(), marked_enc.end(), SCHEME_MARKER_ID,
+                                                              SCHEME_MARKER_ID + sizeof(SCHEME_MARKER_ID));
+        check(id != marked_enc.end(), "scheme marker present");
+        if (id == marked_enc.end())
+            continue;
+        id[SCHEME_MARKER_LENGTH - 1] = 0xEE;
+        check(apiTransform(marked_enc, marked_enc.size(), 0, 1, output) == JPEG_ENCRYPT_UNSUPPORTED_SCHEME, "api rejects unknown scheme versions");
+    }
+}
+
+int main()
+{
+    static const testImage images[] = {
+        {"4:2:0 baseline", 96, 80, 3, 2, 2, 0},
+        {"4:2:0 with restart markers", 96, 80, 3, 2, 2, 2},
+        {"4:2:0 odd size", 123, 77, 3, 2, 2, 0},
+        {"4:2:2", 90, 64, 3, 2, 1, 0},
+        {"4:1:1", 100, 40, 3, 4, 1, 0},
+        {"4:4:4", 64, 48, 3, 1, 1, 0},
+        {"grayscale odd size", 77, 61, 1, 1, 1, 0},
+    };
+    WorkStealingPool pool(2);
+    for (size_t i = 0; i < sizeof(images) / sizeof(images[0]); ++i)
+    {
+        testFastCodec(images[i], NULL);
+        testFastCodec(images[i], &pool);
+        testRoundTrip(images[i]);
+        testEquivalentOptions(images[i], &pool);
+    }
+
+    testZigzagKernels();
+    testCanSwapDccHalves();
+    testRunIndexLimit();
+    testDeriveGroupOrder();
+    testApi();
+
+    if (failure_num > 0)
+    {
+        printf("%d checks FAILED.\n", failure_num);
+        return EXIT_FAILURE;
+    }
+    printf("All tests passed.\n");
+    return 0;
+}
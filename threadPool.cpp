@@ -0,0 +1,219 @@
+#include "threadPool.h"
+
+#include <assert.h>
+#include <atomic>
+
+// 当前线程在所属线程池中的编号，非工作线程为 -1
+static thread_local const WorkStealingPool *current_pool = NULL;
+static thread_local long current_worker = -1;
+
+/**
+ * @brief 构造函数，启动 thread_num 个工作线程
+ * @param thread_num 工作线程数量 (至少为 1)
+ */
+WorkStealingPool::WorkStealingPool(size_t thread_num)
+    : m_queued(0), m_unfinished(0), m_next_queue(0), m_stop(false)
+{
+    if (thread_num < 1)
+        thread_num = 1;
+
+    for (size_t i = 0; i < thread_num; ++i)
+        m_queues.emplace_back(new WorkerQueue);
+    for (size_t i = 0; i < thread_num; ++i)
+        m_threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv_work.notify_all();
+    for (size_t i = 0; i < m_threads.size(); ++i)
+        m_threads[i].join();
+}
+
+/**
+ * @brief 提交任务
+ * @param task 待执行的任务
+ */
+void WorkStealingPool::submit(std::function<void()> task)
+{
+    size_t target;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (current_pool == this)
+            target = current_worker;
+        else
+            target = m_next_queue++ % m_queues.size();
+        ++m_queued;
+        ++m_unfinished;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_queues[target]->mutex);
+        m_queues[target]->tasks.push_back(std::move(task));
+    }
+    m_cv_work.notify_one();
+}
+
+/**
+ * @brief 阻塞直到所有已提交的任务执行完毕
+ */
+void WorkStealingPool::wait()
+{
+    assert(current_pool != this); // 工作线程内等待会造成死锁
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv_done.wait(lock, [this]
+                   { return m_unfinished == 0; });
+}
+
+/**
+ * @brief 取出一个任务：先从自己队列的队首取，再从其他队列的队尾窃取
+ * @param self 当前工作线程编号
+ * @param task 取出的任务
+ * @return 是否取到任务
+ */
+bool WorkStealingPool::popTask(size_t self, std::function<void()> &task)
+{
+    size_t queue_num = m_queues.size();
+    for (size_t offset = 0; offset < queue_num; ++offset)
+    {
+        WorkerQueue &queue = *m_queues[(self + offset) % queue_num];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+
+        if (offset == 0)
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        else
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 工作线程主循环
+ * @param index 工作线程编号
+ */
+void WorkStealingPool::workerLoop(size_t index)
+{
+    current_pool = this;
+    current_worker = index;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv_work.wait(lock, [this]
+                           { return m_stop || m_queued > 0; });
+            if (m_queued == 0)
+                return; // m_stop 且没有剩余任务
+            --m_queued;
+        }
+
+        // m_queued 已为本线程预留了一个任务，它必然在某个队列中
+        std::function<void()> task;
+        while (!popTask(index, task))
+            std::this_thread::yield();
+
+        task();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_unfinished == 0)
+            m_cv_done.notify_all();
+    }
+}
+
+// parallelFor 的共享状态，由调用线程和辅助任务共同持有
+typedef struct
+{
+    std::atomic<size_t> next_chunk;
+    size_t chunk_num;
+    size_t begin, end, grain;
+    const std::function<void(size_t, size_t)> *body;
+
+    std::mutex mutex;
+    std::condition_variable cv_done;
+    size_t finished_chunks; // 受 mutex 保护
+} parallelForState;
+
+/**
+ * @brief 反复领取并执行分块，直到所有分块都已被领取
+ * 分块全部领取后才启动的辅助任务不会访问 body，因此调用线程返回后它们仍可安全退出。
+ * @param state 共享状态
+ */
+static void runChunks(parallelForState &state)
+{
+    size_t done = 0;
+    for (;;)
+    {
+        size_t chunk = state.next_chunk.fetch_add(1);
+        if (chunk >= state.chunk_num)
+            break;
+        size_t chunk_begin = state.begin + chunk * state.grain;
+        size_t chunk_end = chunk_begin + state.grain < state.end ? chunk_begin + state.grain : state.end;
+        (*state.body)(chunk_begin, chunk_end);
+        ++done;
+    }
+
+    if (done > 0)
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.finished_chunks += done;
+        if (state.finished_chunks == state.chunk_num)
+            state.cv_done.notify_all();
+    }
+}
+
+/**
+ * @brief 将区间 [begin, end) 按 grain 大小分块并行执行 body(chunk_begin, chunk_end)
+ * @param pool 线程池 (可为 NULL)
+ * @param begin 区间起点
+ * @param end 区间终点 (不含)
+ * @param grain 每个分块的大小
+ * @param body 分块处理函数，各分块之间不能有数据依赖
+ */
+void parallelFor(WorkStealingPool *pool, size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)> &body)
+{
+    if (begin >= end)
+        return;
+    if (grain < 1)
+        grain = 1;
+
+    size_t chunk_num = (end - begin + grain - 1) / grain;
+    if (pool == NULL || pool->size() < 2 || chunk_num < 2)
+    {
+        body(begin, end);
+        return;
+    }
+
+    std::shared_ptr<parallelForState> state(new parallelForState);
+    state->next_chunk = 0;
+    state->chunk_num = chunk_num;
+    state->begin = begin;
+    state->end = end;
+    state->grain = grain;
+    state->body = &body;
+    state->finished_chunks = 0;
+
+    // 调用线程本身也参与，最多再请求 size() - 1 个辅助任务
+    size_t helper_num = pool->size() - 1 < chunk_num - 1 ? pool->size() - 1 : chunk_num - 1;
+    for (size_t i = 0; i < helper_num; ++i)
+        pool->submit([state]
+                     { runChunks(*state); });
+
+    runChunks(*state);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv_done.wait(lock, [&state]
+                        { return state->finished_chunks == state->chunk_num; });
+}
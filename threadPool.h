@@ -0,0 +1,82 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <stddef.h>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief 工作窃取线程池
+ * 每个工作线程拥有自己的任务队列：从队首取自己的任务，空闲时从其他线程队尾窃取任务。
+ * 某个线程被耗时很长的任务占用时，排在它后面的任务会被空闲线程取走，不会被阻塞。
+ */
+class WorkStealingPool
+{
+private:
+    // 单个工作线程的任务队列
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;               // 保护以下状态
+    std::condition_variable m_cv_work; // 有新任务或线程池关闭
+    std::condition_variable m_cv_done; // 所有任务执行完毕
+    size_t m_queued;                  // 已提交但尚未被取走的任务数
+    size_t m_unfinished;              // 已提交但尚未执行完毕的任务数
+    size_t m_next_queue;              // 外部线程提交任务时轮流选择的队列
+    bool m_stop;
+
+    WorkStealingPool(const WorkStealingPool &);
+    WorkStealingPool &operator=(const WorkStealingPool &);
+
+    bool popTask(size_t self, std::function<void()> &task);
+    void workerLoop(size_t index);
+
+public:
+    /**
+     * @brief 构造函数，启动 thread_num 个工作线程
+     * @param thread_num 工作线程数量 (至少为 1)
+     */
+    explicit WorkStealingPool(size_t thread_num);
+    ~WorkStealingPool();
+
+    /**
+     * @brief 提交任务
+     * 工作线程内提交的任务进入自己的队列，外部线程提交的任务轮流分配到各队列。
+     * @param task 待执行的任务
+     */
+    void submit(std::function<void()> task);
+
+    // 阻塞直到所有已提交的任务执行完毕
+    void wait();
+
+    // 工作线程数量
+    size_t size() const
+    {
+        return m_threads.size();
+    }
+};
+
+/**
+ * @brief 将区间 [begin, end) 按 grain 大小分块并行执行 body(chunk_begin, chunk_end)
+ * 调用线程自己也领取分块，只等待已被其他线程领取的分块完成，不等待整个线程池，
+ * 因此可以在线程池的任务内部嵌套调用。pool 为 NULL 或区间不超过一个分块时直接串行执行。
+ * @param pool 线程池 (可为 NULL)
+ * @param begin 区间起点
+ * @param end 区间终点 (不含)
+ * @param grain 每个分块的大小
+ * @param body 分块处理函数，各分块之间不能有数据依赖
+ */
+void parallelFor(WorkStealingPool *pool, size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)> &body);
+
+#endif // THREADPOOL_H
@@ -0,0 +1,255 @@
+#include "zigzag.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ZIGZAG_X86 1
+#include <immintrin.h>
+#endif
+
+static_assert(sizeof(JCOEF) == 2, "SIMD kernels assume 16-bit JCOEF");
+
+// 原 main.cpp 中手写的AC系数 zigzag 扫描顺序，用于校验编译期生成的表
+constexpr int legacy_zigzag[DCTSIZE2 - 1] = {1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5, 12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7,
+                                             14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53,
+                                             60, 61, 54, 47, 55, 62, 63};
+
+constexpr bool matchesLegacyZigzag()
+{
+    for (int lane = 0; lane < DCTSIZE2 - 1; ++lane)
+    {
+        if (zigzag_tables.forward[lane] != legacy_zigzag[lane])
+            return false;
+    }
+    for (int natural = 0; natural < DCTSIZE2; ++natural)
+    {
+        if (zigzag_tables.forward[zigzag_tables.inverse[natural]] != natural)
+            return false;
+    }
+    return zigzag_tables.forward[DCTSIZE2 - 1] == 0;
+}
+static_assert(matchesLegacyZigzag(), "generated zigzag tables differ from the legacy table");
+
+/*************************************************** 标量实现 ***************************************************/
+
+static void blockToZigzagScalar(const JCOEF *block, JCOEF *lanes)
+{
+    for (int lane = 0; lane < DCTSIZE2; ++lane)
+        lanes[lane] = block[zigzag_tables.forward[lane]];
+}
+
+static void zigzagToBlockScalar(const JCOEF *lanes, JCOEF *block)
+{
+    for (int natural = 0; natural < DCTSIZE2; ++natural)
+        block[natural] = lanes[zigzag_tables.inverse[natural]];
+}
+
+static uint64_t nonZeroMaskScalar(const JCOEF *coef)
+{
+    uint64_t mask = 0;
+    for (int i = 0; i < DCTSIZE2; ++i)
+    {
+        if (coef[i] != 0)
+            mask |= 1ULL << i;
+    }
+    return mask;
+}
+
+#ifdef ZIGZAG_X86
+
+/*************************************************** SIMD 实现 ***************************************************/
+
+/* 字节重排程序：输出寄存器 dst |= pshufb(源数据块 src, mask)。
+ * 每个 128 位数据块含 8 个系数，mask 中 0x80 表示该字节不取自 src。
+ * 只记录确实有系数来自 src 的 (dst, src) 组合，zigzag 的局部性使步数远少于全组合数。
+ */
+struct ShuffleStep
+{
+    alignas(32) uint8_t mask[32];
+    uint8_t dst;
+    uint8_t src;
+};
+
+struct ShuffleProgram
+{
+    ShuffleStep steps[64];
+    int count;
+};
+
+/**
+ * @brief 生成 64 个 16 位通道的重排程序：out[i] = in[perm[i]]
+ * @param perm 重排表
+ * @param lanes_per_reg 每个输出寄存器的通道数 (SSE 为 8，AVX2 为 16)
+ * AVX2 的 vpshufb 只能在 128 位半区内取数，因此源数据块会被广播到两个半区。
+ */
+constexpr ShuffleProgram makeShuffleProgram(const uint8_t *perm, int lanes_per_reg)
+{
+    ShuffleProgram program = {};
+    for (int dst = 0; dst < DCTSIZE2 / lanes_per_reg; ++dst)
+    {
+        for (int src = 0; src < DCTSIZE2 / 8; ++src)
+        {
+            ShuffleStep step = {};
+            bool used = false;
+            for (int lane = 0; lane < lanes_per_reg; ++lane)
+            {
+                int index = perm[dst * lanes_per_reg + lane];
+                uint8_t lo = 0x80, hi = 0x80;
+                if (index / 8 == src)
+                {
+                    lo = 2 * (index % 8);
+                    hi = lo + 1;
+                    used = true;
+                }
+                step.mask[2 * lane] = lo;
+                step.mask[2 * lane + 1] = hi;
+            }
+            if (used)
+            {
+                step.dst = dst;
+                step.src = src;
+                program.steps[program.count++] = step;
+            }
+        }
+    }
+    return program;
+}
+
+static constexpr ShuffleProgram to_zigzag_sse = makeShuffleProgram(zigzag_tables.forward, 8);
+static constexpr ShuffleProgram to_block_sse = makeShuffleProgram(zigzag_tables.inverse, 8);
+static constexpr ShuffleProgram to_zigzag_avx2 = makeShuffleProgram(zigzag_tables.forward, 16);
+static constexpr ShuffleProgram to_block_avx2 = makeShuffleProgram(zigzag_tables.inverse, 16);
+
+// 重排程序在编译期确定，循环完全展开后寄存器下标均为常量
+template <const ShuffleProgram &program>
+__attribute__((target("sse4.1"))) static void permuteSse41(const JCOEF *in, JCOEF *out)
+{
+    __m128i src[DCTSIZE2 / 8];
+    __m128i acc[DCTSIZE2 / 8];
+#pragma GCC unroll 8
+    for (int i = 0; i < DCTSIZE2 / 8; ++i)
+    {
+        src[i] = _mm_loadu_si128((const __m128i *)(in + 8 * i));
+        acc[i] = _mm_setzero_si128();
+    }
+
+#pragma GCC unroll 64
+    for (int k = 0; k < program.count; ++k)
+    {
+        const ShuffleStep &step = program.steps[k];
+        __m128i mask = _mm_load_si128((const __m128i *)step.mask);
+        acc[step.dst] = _mm_or_si128(acc[step.dst], _mm_shuffle_epi8(src[step.src], mask));
+    }
+
+    for (int i = 0; i < DCTSIZE2 / 8; ++i)
+        _mm_storeu_si128((__m128i *)(out + 8 * i), acc[i]);
+}
+
+template <const ShuffleProgram &program>
+__attribute__((target("avx2"))) static void permuteAvx2(const JCOEF *in, JCOEF *out)
+{
+    __m256i src[DCTSIZE2 / 8];
+    __m256i acc[DCTSIZE2 / 16];
+#pragma GCC unroll 8
+    for (int i = 0; i < DCTSIZE2 / 8; ++i)
+        src[i] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(in + 8 * i)));
+    for (int i = 0; i < DCTSIZE2 / 16; ++i)
+        acc[i] = _mm256_setzero_si256();
+
+#pragma GCC unroll 64
+    for (int k = 0; k < program.count; ++k)
+    {
+        const ShuffleStep &step = program.steps[k];
+        __m256i mask = _mm256_load_si256((const __m256i *)step.mask);
+        acc[step.dst] = _mm256_or_si256(acc[step.dst], _mm256_shuffle_epi8(src[step.src], mask));
+    }
+
+    for (int i = 0; i < DCTSIZE2 / 16; ++i)
+        _mm256_storeu_si256((__m256i *)(out + 16 * i), acc[i]);
+}
+
+__attribute__((target("sse4.1"))) static uint64_t nonZeroMaskSse41(const JCOEF *coef)
+{
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t mask = 0;
+    for (int i = 0; i < DCTSIZE2 / 16; ++i)
+    {
+        __m128i lo = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(coef + 16 * i)), zero);
+        __m128i hi = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(coef + 16 * i + 8)), zero);
+        uint32_t zero_bits = _mm_movemask_epi8(_mm_packs_epi16(lo, hi));
+        mask |= (uint64_t)(~zero_bits & 0xFFFF) << (16 * i);
+    }
+    return mask;
+}
+
+__attribute__((target("avx2"))) static uint64_t nonZeroMaskAvx2(const JCOEF *coef)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i c0 = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)coef), zero);
+    __m256i c1 = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(coef + 16)), zero);
+    __m256i c2 = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(coef + 32)), zero);
+    __m256i c3 = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(coef + 48)), zero);
+
+    // vpacksswb 在两个 128 位半区内分别打包，需要再按 64 位重排回原顺序
+    __m256i p01 = _mm256_permute4x64_epi64(_mm256_packs_epi16(c0, c1), 0xD8);
+    __m256i p23 = _mm256_permute4x64_epi64(_mm256_packs_epi16(c2, c3), 0xD8);
+    uint64_t zero_bits = (uint32_t)_mm256_movemask_epi8(p01) | ((uint64_t)(uint32_t)_mm256_movemask_epi8(p23) << 32);
+    return ~zero_bits;
+}
+
+#endif // ZIGZAG_X86
+
+/*************************************************** 运行时分发 ***************************************************/
+
+typedef struct
+{
+    void (*to_zigzag)(const JCOEF *, JCOEF *);
+    void (*to_block)(const JCOEF *, JCOEF *);
+    uint64_t (*non_zero_mask)(const JCOEF *);
+} zigzagKernels;
+
+static zigzagKernels selectKernels()
+{
+#ifdef ZIGZAG_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return {permuteAvx2<to_zigzag_avx2>, permuteAvx2<to_block_avx2>, nonZeroMaskAvx2};
+    if (__builtin_cpu_supports("sse4.1"))
+        return {permuteSse41<to_zigzag_sse>, permuteSse41<to_block_sse>, nonZeroMaskSse41};
+#endif
+    return {blockToZigzagScalar, zigzagToBlockScalar, nonZeroMaskScalar};
+}
+
+static const zigzagKernels &kernels()
+{
+    static const zigzagKernels selected = selectKernels();
+    return selected;
+}
+
+/**
+ * @brief 将自然顺序的DCT块重排为 64 通道的 zigzag 顺序
+ * @param block 自然顺序的 64 个系数 (libjpeg 的 JBLOCK)
+ * @param lanes 输出：lanes[i] = block[zigzag_tables.forward[i]]，通道 63 为DC
+ */
+void blockToZigzag(const JCOEF *block, JCOEF *lanes)
+{
+    kernels().to_zigzag(block, lanes);
+}
+
+/**
+ * @brief 将 64 通道的 zigzag 顺序写回自然顺序 (blockToZigzag 的逆操作)
+ * @param lanes zigzag 顺序的 64 个通道，通道 63 为DC
+ * @param block 输出：自然顺序的 64 个系数
+ */
+void zigzagToBlock(const JCOEF *lanes, JCOEF *block)
+{
+    kernels().to_block(lanes, block);
+}
+
+/**
+ * @brief 计算 64 个系数的非零位图
+ * @param coef 64 个系数
+ * @return 第 i 位为 1 表示 coef[i] 不为 0
+ */
+uint64_t nonZeroMask(const JCOEF *coef)
+{
+    return kernels().non_zero_mask(coef);
+}
@@ -0,0 +1,90 @@
+#ifndef ZIGZAG_H
+#define ZIGZAG_H
+
+#include <stdint.h>
+#include <stdio.h> // jpeglib.h 需要 FILE 与 size_t
+
+#include "jpeglib.h" // JCOEF, DCTSIZE, DCTSIZE2
+
+/* 64 通道的 zigzag 重排表 (编译期生成)：
+ * 通道 0..62 依次为 zigzag 顺序的第 1..63 个系数 (即63个AC系数)，通道 63 存放DC系数，
+ * 这样一个块正好重排为 64 个通道，可以整块用 SIMD 指令处理。
+ * forward[lane] 为通道 lane 对应的自然顺序下标，inverse[natural] 为自然顺序下标对应的通道。
+ */
+struct ZigzagTables
+{
+    uint8_t forward[DCTSIZE2];
+    uint8_t inverse[DCTSIZE2];
+};
+
+// 按JPEG标准的 zigzag 扫描路径生成重排表
+constexpr ZigzagTables makeZigzagTables()
+{
+    ZigzagTables tables = {};
+    int row = 0, col = 0;
+    for (int order = 0; order < DCTSIZE2; ++order)
+    {
+        int natural = row * DCTSIZE + col;
+        int lane = (order == 0) ? DCTSIZE2 - 1 : order - 1;
+        tables.forward[lane] = natural;
+        tables.inverse[natural] = lane;
+
+        // 对角线序号为偶数时向右上方移动，为奇数时向左下方移动
+        if ((row + col) % 2 == 0)
+        {
+            if (col == DCTSIZE - 1)
+                ++row;
+            else if (row == 0)
+                ++col;
+            else
+            {
+                --row;
+                ++col;
+            }
+        }
+        else
+        {
+            if (row == DCTSIZE - 1)
+                ++col;
+            else if (col == 0)
+                ++row;
+            else
+            {
+                ++row;
+                --col;
+            }
+        }
+    }
+    return tables;
+}
+
+inline constexpr ZigzagTables zigzag_tables = makeZigzagTables();
+
+/**
+ * @brief 将自然顺序的DCT块重排为 64 通道的 zigzag 顺序
+ * @param block 自然顺序的 64 个系数 (libjpeg 的 JBLOCK)
+ * @param lanes 输出：lanes[i] = block[zigzag_tables.forward[i]]，通道 63 为DC
+ */
+void blockToZigzag(const JCOEF *block, JCOEF *lanes);
+
+/**
+ * @brief 将 64 通道的 zigzag 顺序写回自然顺序 (blockToZigzag 的逆操作)
+ * @param lanes zigzag 顺序的 64 个通道，通道 63 为DC
+ * @param block 输出：自然顺序的 64 个系数
+ */
+void zigzagToBlock(const JCOEF *lanes, JCOEF *block);
+
+/**
+ * @brief 计算 64 个系数的非零位图
+ * @param coef 64 个系数
+ * @return 第 i 位为 1 表示 coef[i] 不为 0
+ */
+uint64_t nonZeroMask(const JCOEF *coef);
+
+// 自然顺序DCT块中非零AC系数的数量 (不计 block[0] 处的DC)
+inline int countNonZeroAc(const JCOEF *block)
+{
+    return __builtin_popcountll(nonZeroMask(block) & ~1ULL);
+}
+
+#endif // ZIGZAG_H